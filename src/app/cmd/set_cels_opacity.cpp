@@ -0,0 +1,69 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/set_cels_opacity.h"
+
+#include "app/doc.h"
+#include "app/doc_event.h"
+#include "doc/cel.h"
+
+namespace app {
+namespace cmd {
+
+using namespace doc;
+
+void SetCelsOpacity::addCel(Cel* cel, int opacity)
+{
+  ASSERT(m_cels.empty() || m_newOpacity == opacity);
+  m_newOpacity = opacity;
+
+  if (cel->opacity() == opacity)
+    return;
+
+  m_cels.push_back(cel->id());
+  m_oldOpacity.push_back(uint8_t(cel->opacity()));
+}
+
+void SetCelsOpacity::onExecute()
+{
+  for (const ObjectId celId : m_cels) {
+    Cel* cel = get<Cel>(celId);
+    cel->setOpacity(m_newOpacity);
+    cel->data()->incrementVersion();
+  }
+}
+
+void SetCelsOpacity::onUndo()
+{
+  for (size_t i=0; i<m_cels.size(); ++i) {
+    Cel* cel = get<Cel>(m_cels[i]);
+    cel->setOpacity(m_oldOpacity[i]);
+    cel->data()->incrementVersion();
+  }
+}
+
+void SetCelsOpacity::onFireNotifications()
+{
+  if (m_cels.empty())
+    return;
+
+  Cel* firstCel = get<Cel>(m_cels.front());
+  Doc* doc = static_cast<Doc*>(firstCel->document());
+  DocEvent ev(doc);
+  ev.sprite(firstCel->sprite());
+
+  for (const ObjectId celId : m_cels) {
+    ev.cel(get<Cel>(celId));
+    doc->notify_observers<DocEvent&>(&DocObserver::onCelOpacityChange, ev);
+  }
+}
+
+} // namespace cmd
+} // namespace app
@@ -0,0 +1,59 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CMD_SET_CELS_OPACITY_H_INCLUDED
+#define APP_CMD_SET_CELS_OPACITY_H_INCLUDED
+#pragma once
+
+#include "app/cmd.h"
+#include "doc/object_id.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace doc {
+  class Cel;
+}
+
+namespace app {
+namespace cmd {
+  using namespace doc;
+
+  // Changes the opacity of several cels in one undo record (e.g. to
+  // change the opacity of a range of cels), instead of one
+  // SetCelOpacity per cel.
+  class SetCelsOpacity : public Cmd {
+  public:
+    SetCelsOpacity() { }
+
+    // Adds a cel to be modified (must be called before executing
+    // the command). Cels that already have the given opacity are
+    // ignored.
+    void addCel(Cel* cel, int opacity);
+
+    bool empty() const { return m_cels.empty(); }
+
+  protected:
+    void onExecute() override;
+    void onUndo() override;
+    void onFireNotifications() override;
+    size_t onMemSize() const override {
+      return sizeof(*this) +
+        m_cels.capacity() * sizeof(ObjectId) +
+        m_oldOpacity.capacity() * sizeof(uint8_t);
+    }
+
+  private:
+    std::vector<ObjectId> m_cels;
+    std::vector<uint8_t> m_oldOpacity;
+    // All cels get the same opacity
+    int m_newOpacity = 255;
+  };
+
+} // namespace cmd
+} // namespace app
+
+#endif
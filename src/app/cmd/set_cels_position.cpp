@@ -0,0 +1,68 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/set_cels_position.h"
+
+#include "app/doc.h"
+#include "app/doc_event.h"
+#include "doc/cel.h"
+
+namespace app {
+namespace cmd {
+
+using namespace doc;
+
+void SetCelsPosition::addCel(Cel* cel, const gfx::Point& newPos)
+{
+  if (cel->position() == newPos)
+    return;
+
+  m_cels.push_back(cel->id());
+  m_oldPos.push_back(cel->position());
+  m_newPos.push_back(newPos);
+}
+
+void SetCelsPosition::onExecute()
+{
+  setPositions(m_newPos);
+}
+
+void SetCelsPosition::onUndo()
+{
+  setPositions(m_oldPos);
+}
+
+void SetCelsPosition::onFireNotifications()
+{
+  if (m_cels.empty())
+    return;
+
+  Cel* firstCel = get<Cel>(m_cels.front());
+  Doc* doc = static_cast<Doc*>(firstCel->document());
+  DocEvent ev(doc);
+  ev.sprite(firstCel->sprite());
+
+  for (const ObjectId celId : m_cels) {
+    ev.cel(get<Cel>(celId));
+    doc->notify_observers<DocEvent&>(&DocObserver::onCelPositionChanged, ev);
+  }
+}
+
+void SetCelsPosition::setPositions(const std::vector<gfx::Point>& positions)
+{
+  for (size_t i=0; i<m_cels.size(); ++i) {
+    Cel* cel = get<Cel>(m_cels[i]);
+    cel->data()->setPosition(positions[i]);
+    cel->data()->incrementVersion();
+  }
+}
+
+} // namespace cmd
+} // namespace app
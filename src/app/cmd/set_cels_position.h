@@ -0,0 +1,60 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CMD_SET_CELS_POSITION_H_INCLUDED
+#define APP_CMD_SET_CELS_POSITION_H_INCLUDED
+#pragma once
+
+#include "app/cmd.h"
+#include "doc/object_id.h"
+#include "gfx/point.h"
+
+#include <vector>
+
+namespace doc {
+  class Cel;
+}
+
+namespace app {
+namespace cmd {
+  using namespace doc;
+
+  // Changes the position of several cels in one undo record (e.g.
+  // when we move a range of cels with the mouse), instead of one
+  // SetCelPosition per cel.
+  class SetCelsPosition : public Cmd {
+  public:
+    SetCelsPosition() { }
+
+    // Adds a cel to be moved to the given position (must be called
+    // before executing the command). Cels that are already in the
+    // given position are ignored.
+    void addCel(Cel* cel, const gfx::Point& newPos);
+
+    bool empty() const { return m_cels.empty(); }
+
+  protected:
+    void onExecute() override;
+    void onUndo() override;
+    void onFireNotifications() override;
+    size_t onMemSize() const override {
+      return sizeof(*this) +
+        m_cels.capacity() * sizeof(ObjectId) +
+        (m_oldPos.capacity() + m_newPos.capacity()) * sizeof(gfx::Point);
+    }
+
+  private:
+    void setPositions(const std::vector<gfx::Point>& positions);
+
+    std::vector<ObjectId> m_cels;
+    std::vector<gfx::Point> m_oldPos;
+    std::vector<gfx::Point> m_newPos;
+  };
+
+} // namespace cmd
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -12,6 +12,8 @@
 
 #include "doc/tileset.h"
 
+#include <utility>
+
 namespace app {
 namespace cmd {
 
@@ -23,22 +25,22 @@ SetTileDataProperties::SetTileDataProperties(
   : WithTileset(ts)
   , m_ti(ti)
   , m_group(group)
-  , m_oldProperties(ts->getTileData(ti).properties(group))
-  , m_newProperties(std::move(newProperties))
+  , m_diff(doc::diff_properties(std::as_const(ts->getTileData(ti)).properties(group),
+                                newProperties))
 {
 }
 
 void SetTileDataProperties::onExecute()
 {
   auto ts = tileset();
-  ts->getTileData(m_ti).properties(m_group) = m_newProperties;
+  doc::apply_properties_diff(ts->getTileData(m_ti).properties(m_group), m_diff, false);
   ts->incrementVersion();
 }
 
 void SetTileDataProperties::onUndo()
 {
   auto ts = tileset();
-  ts->getTileData(m_ti).properties(m_group) = m_oldProperties;
+  doc::apply_properties_diff(ts->getTileData(m_ti).properties(m_group), m_diff, true);
   ts->incrementVersion();
 }
 
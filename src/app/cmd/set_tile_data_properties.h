@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -29,14 +29,15 @@ namespace cmd {
     void onExecute() override;
     void onUndo() override;
     size_t onMemSize() const override {
-      return sizeof(*this);     // TODO + properties size
+      return sizeof(*this) +
+        m_diff.size() * sizeof(doc::PropertyChange);
     }
 
   private:
     doc::tile_index m_ti;
     std::string m_group;
-    doc::UserData::Properties m_oldProperties;
-    doc::UserData::Properties m_newProperties;
+    // Only the changed properties are stored
+    doc::PropertiesDiff m_diff;
   };
 
 } // namespace cmd
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -25,7 +25,7 @@ SetTileDataProperty::SetTileDataProperty(
   , m_ti(ti)
   , m_group(group)
   , m_field(field)
-  , m_oldValue(ts->getTileData(m_ti).properties(m_group)[m_field])
+  , m_oldValue(ts->getTileData(m_ti).getPropertyValue(m_group, m_field))
   , m_newValue(std::move(newValue))
 {
 }
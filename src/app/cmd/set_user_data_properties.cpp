@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -12,6 +12,8 @@
 
 #include "doc/with_user_data.h"
 
+#include <utility>
+
 namespace app {
 namespace cmd {
 
@@ -21,22 +23,22 @@ SetUserDataProperties::SetUserDataProperties(
   doc::UserData::Properties&& newProperties)
   : m_objId(obj->id())
   , m_group(group)
-  , m_oldProperties(obj->userData().properties(group))
-  , m_newProperties(std::move(newProperties))
+  , m_diff(doc::diff_properties(std::as_const(obj->userData()).properties(group),
+                                newProperties))
 {
 }
 
 void SetUserDataProperties::onExecute()
 {
   auto obj = doc::get<doc::WithUserData>(m_objId);
-  obj->userData().properties(m_group) = m_newProperties;
+  doc::apply_properties_diff(obj->userData().properties(m_group), m_diff, false);
   obj->incrementVersion();
 }
 
 void SetUserDataProperties::onUndo()
 {
   auto obj = doc::get<doc::WithUserData>(m_objId);
-  obj->userData().properties(m_group) = m_oldProperties;
+  doc::apply_properties_diff(obj->userData().properties(m_group), m_diff, true);
   obj->incrementVersion();
 }
 
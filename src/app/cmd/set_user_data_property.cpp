@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -23,7 +23,7 @@ SetUserDataProperty::SetUserDataProperty(
   : m_objId(obj->id())
   , m_group(group)
   , m_field(field)
-  , m_oldValue(obj->userData().properties(group)[m_field])
+  , m_oldValue(obj->userData().getPropertyValue(group, field))
   , m_newValue(std::move(newValue))
 {
 }
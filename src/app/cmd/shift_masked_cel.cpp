@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -28,9 +28,27 @@ ShiftMaskedCel::ShiftMaskedCel(Cel* cel, int dx, int dy)
 {
 }
 
+void ShiftMaskedCel::prepare()
+{
+  Cel* cel = this->cel();
+  const Mask* mask = static_cast<Doc*>(cel->document())->mask();
+  ASSERT(mask->bitmap());
+  if (!mask->bitmap())
+    return;
+
+  m_preparedImage =
+    doc::algorithm::shift_image_with_mask(cel, mask, m_dx, m_dy,
+                                          m_preparedBounds);
+}
+
 void ShiftMaskedCel::onExecute()
 {
-  shift(m_dx, m_dy);
+  if (m_preparedImage) {
+    setShiftedImage(m_preparedImage, m_preparedBounds);
+    m_preparedImage.reset();
+  }
+  else
+    shift(m_dx, m_dy);
 }
 
 void ShiftMaskedCel::onUndo()
@@ -49,7 +67,13 @@ void ShiftMaskedCel::shift(int dx, int dy)
   gfx::Rect newBounds;
   ImageRef newImage =
     doc::algorithm::shift_image_with_mask(cel, mask, dx, dy, newBounds);
+  setShiftedImage(newImage, newBounds);
+}
 
+void ShiftMaskedCel::setShiftedImage(const ImageRef& newImage,
+                                     const gfx::Rect& newBounds)
+{
+  Cel* cel = this->cel();
   ImageRef oldImage = cel->imageRef();
   if (!is_same_image(oldImage.get(), newImage.get())) {
     ObjectId id = oldImage->id();
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -10,6 +11,8 @@
 
 #include "app/cmd.h"
 #include "app/cmd/with_cel.h"
+#include "doc/image_ref.h"
+#include "gfx/rect.h"
 
 namespace app {
 namespace cmd {
@@ -20,6 +23,11 @@ namespace cmd {
   public:
     ShiftMaskedCel(Cel* cel, int dx, int dy);
 
+    // Calculates the shifted image before executing the command. It
+    // doesn't modify the document, so it can be called from other
+    // threads (e.g. to shift several cels in parallel).
+    void prepare();
+
   protected:
     void onExecute() override;
     void onUndo() override;
@@ -29,8 +37,12 @@ namespace cmd {
 
   private:
     void shift(int dx, int dy);
+    void setShiftedImage(const ImageRef& newImage,
+                         const gfx::Rect& newBounds);
 
     int m_dx, m_dy;
+    ImageRef m_preparedImage;
+    gfx::Rect m_preparedBounds;
   };
 
 } // namespace cmd
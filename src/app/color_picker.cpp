@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -35,6 +35,12 @@ namespace {
 
 const int kOpacityThreshold = 1;
 
+// Render plans used to pick colors from the composed image, cached
+// between picks because the eyedropper/pick-ink samples the same
+// sprite/frame several times while the mouse is moved (only used
+// from the UI thread).
+doc::RenderPlanCache g_plans;
+
 bool get_cel_pixel(const Cel* cel,
                    const double x,
                    const double y,
@@ -107,11 +113,10 @@ void ColorPicker::pickColor(const Site& site,
 
     // Pick from the composed image
     case FromComposition: {
-      doc::RenderPlan plan;
-      plan.addLayer(sprite->root(), site.frame());
+      const doc::RenderPlanRef plan = g_plans.plan(sprite->root(), site.frame());
 
       doc::CelList cels;
-      sprite->pickCels(pos, kOpacityThreshold, plan, cels);
+      sprite->pickCels(pos, kOpacityThreshold, *plan, cels);
       if (!cels.empty())
         m_layer = cels.front()->layer();
 
@@ -136,7 +141,8 @@ void ColorPicker::pickColor(const Site& site,
           sprite->pixelFormat(),
           render::get_sprite_pixel(sprite, pos.x, pos.y,
                                    site.frame(), proj,
-                                   Preferences::instance().experimental.newBlend()));
+                                   Preferences::instance().experimental.newBlend(),
+                                   plan.get()));
       }
       break;
     }
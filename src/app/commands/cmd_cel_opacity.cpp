@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2022  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -10,7 +10,7 @@
 #endif
 
 #include "app/app.h"
-#include "app/cmd/set_cel_opacity.h"
+#include "app/cmd/set_cels_opacity.h"
 #include "app/commands/command.h"
 #include "app/commands/params.h"
 #include "app/context.h"
@@ -24,6 +24,7 @@
 #include "doc/sprite.h"
 #include "fmt/format.h"
 
+#include <memory>
 #include <string>
 
 namespace app {
@@ -88,15 +89,18 @@ void CelOpacityCommand::onExecute(Context* context)
       range.endRange(layer, cel->frame());
     }
 
+    auto setCelsOpacity = std::make_unique<cmd::SetCelsOpacity>();
     for (Cel* c : cel->sprite()->uniqueCels(range.selectedFrames())) {
       if (range.contains(c->layer())) {
         if (!c->layer()->isBackground() &&
             c->layer()->isEditable() &&
             m_opacity != c->opacity()) {
-          tx(new cmd::SetCelOpacity(c, m_opacity));
+          setCelsOpacity->addCel(c, m_opacity);
         }
       }
     }
+    if (!setCelsOpacity->empty())
+      tx(setCelsOpacity.release());
 
     tx.commit();
   }
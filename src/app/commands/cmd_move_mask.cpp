@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -19,18 +19,56 @@
 #include "app/i18n/strings.h"
 #include "app/modules/gui.h"
 #include "app/pref/preferences.h"
+#include "app/site.h"
 #include "app/tx.h"
 #include "app/ui/doc_view.h"
 #include "app/ui/editor/editor.h"
 #include "app/ui_context.h"
+#include "app/util/range_utils.h"
 #include "base/convert_to.h"
 #include "doc/mask.h"
 #include "doc/sprite.h"
 #include "fmt/format.h"
 #include "ui/view.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
 namespace app {
 
+using ShiftCmds = std::vector<std::unique_ptr<cmd::ShiftMaskedCel>>;
+
+// Calculates the shifted image of each cel in parallel (the document
+// is locked for writing by the caller, so nothing else can modify it
+// meanwhile).
+static void prepare_shift_cmds_in_parallel(ShiftCmds& cmds)
+{
+  const int nthreads =
+    std::clamp(int(std::thread::hardware_concurrency()), 1, int(cmds.size()));
+  std::atomic<size_t> next(0);
+
+  std::vector<std::thread> threads;
+  for (int i=0; i<nthreads; ++i) {
+    threads.emplace_back(
+      [&cmds, &next]{
+        for (size_t j; (j = next++) < cmds.size(); ) {
+          try {
+            cmds[j]->prepare();
+          }
+          catch (...) {
+            // The shifted image will be calculated again when the
+            // command is executed
+          }
+        }
+      });
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
+
 MoveMaskCommand::MoveMaskCommand()
   : Command(CommandId::MoveMask(), CmdRecordableFlag)
 {
@@ -100,10 +138,26 @@ void MoveMaskCommand::onExecute(Context* context)
     case Content:
       if (m_wrap) {
         ContextWriter writer(context);
-        if (writer.cel()) {
+        const Site site = context->activeSite();
+
+        doc::CelList cels;
+        if (site.range().enabled())
+          cels = get_unique_cels_to_edit_pixels(site.sprite(), site.range());
+        else if (writer.cel())
+          cels.push_back(writer.cel());
+
+        if (!cels.empty()) {
+          ShiftCmds cmds;
+          for (doc::Cel* cel : cels)
+            cmds.emplace_back(new cmd::ShiftMaskedCel(cel, delta.x, delta.y));
+
+          if (cmds.size() > 1)
+            prepare_shift_cmds_in_parallel(cmds);
+
           // Rotate content
           Tx tx(writer, "Shift Pixels");
-          tx(new cmd::ShiftMaskedCel(writer.cel(), delta.x, delta.y));
+          for (auto& cmd : cmds)
+            tx(cmd.release());
           tx.commit();
         }
         update_screen_for_document(writer.document());
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,7 @@
 #include "app/commands/params.h"
 #include "app/console.h"
 #include "app/doc.h"
+#include "app/doc_access.h"
 #include "app/file/file.h"
 #include "app/file_selector.h"
 #include "app/i18n/strings.h"
@@ -30,25 +31,138 @@
 #include "doc/sprite.h"
 #include "ui/ui.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <memory>
+#include <vector>
 
 namespace app {
 
+// Milliseconds between each update of the UI with the new frames of a
+// document that is being loaded progressively.
+static const int kLoadingUpdatePeriod = 250;
+
+// Adds the loaded document to the context (so it's displayed in the UI).
+static void add_loaded_document(Context* context, FileOp* fop)
+{
+  if (context->isUIAvailable())
+    App::instance()->recentFiles()->addRecentFile(fop->filename().c_str());
+
+  fop->document()->setContext(context);
+}
+
+// Synchronizes the grid bounds of the sprite with the document
+// preferences. It must be called after FileOp::postLoad() (when the
+// document has its filename and is completely loaded).
+static void load_grid_bounds(Context* context, FileOp* fop)
+{
+  if (!context->isUIAvailable())
+    return;
+
+  Doc* doc = fop->document();
+  auto& docPref = Preferences::instance().document(doc);
+
+  if (fop->hasEmbeddedGridBounds() &&
+      !doc->sprite()->gridBounds().isEmpty()) {
+    // If the sprite contains the grid bounds inside, we put
+    // those grid bounds into the settings (e.g. useful to
+    // interact with old versions of Aseprite saving the grid
+    // bounds in the aseprite.ini file)
+    docPref.grid.bounds(doc->sprite()->gridBounds());
+  }
+  else {
+    // Get grid bounds from preferences
+    doc->sprite()->setGridBounds(docPref.grid.bounds());
+  }
+}
+
+class OpenFileJob;
+
+// Jobs loading documents in background (only accessed from the UI
+// thread).
+static std::vector<OpenFileJob*> g_backgroundJobs;
+
 class OpenFileJob : public Job, public IFileOpProgress {
 public:
-  OpenFileJob(FileOp* fop)
+  OpenFileJob(Context* context, FileOp* fop)
     : Job(Strings::open_file_loading().c_str())
+    , m_context(context)
     , m_fop(fop)
+    , m_background(false)
+    , m_stopped(false)
+    , m_askedPostLoad(false)
+    , m_notifiedFrames(0)
   {
   }
 
-  void showProgressWindow() {
+  ~OpenFileJob() {
+    auto it = std::find(g_backgroundJobs.begin(),
+                        g_backgroundJobs.end(), this);
+    if (it != g_backgroundJobs.end())
+      g_backgroundJobs.erase(it);
+  }
+
+  Doc* document() const { return m_fop->document(); }
+
+  // Returns true if the document was added to the context before it
+  // was completely loaded (see FileOp::setProgressive()), in that
+  // case continueLoading() must be called.
+  bool showProgressWindow() {
     startJob();
 
+    if (m_background)
+      return true;
+
     if (isCanceled())
       m_fop->stop();
 
     waitJob();
+
+    // The document could be published (but not added to the context)
+    // before the job was canceled
+    if (m_fop->isStop() && m_fop->document())
+      delete m_fop->releaseDocument();
+
+    return false;
+  }
+
+  // Keeps updating the UI with the new loaded frames until the file
+  // is completely loaded. Then the post-load process is done and this
+  // job is deleted.
+  void continueLoading(std::unique_ptr<FileOp>&& fop) {
+    ASSERT(m_background);
+    ASSERT(fop.get() == m_fop);
+
+    g_backgroundJobs.push_back(this);
+
+    m_fopOwner = std::move(fop);
+    m_loadingTimer = std::make_unique<ui::Timer>(kLoadingUpdatePeriod);
+    m_loadingTimer->Tick.connect([this]{ onLoadingTick(); });
+    m_loadingTimer->start();
+  }
+
+  // Stops loading the rest of frames (e.g. the user is closing the
+  // document), the document is kept in the context without the
+  // post-load process (and it must be destroyed by the caller), and
+  // this job is deleted later.
+  void stopLoading() {
+    ASSERT(m_background);
+
+    m_stopped = true;
+    m_fop->stop();
+    waitJob();
+
+    // If the timer is not running, onLoadFinished() is already
+    // waiting to be executed and it will delete this job.
+    if (m_loadingTimer->isRunning()) {
+      m_loadingTimer->stop();
+      ui::execute_from_ui_thread([this]{ delete this; });
+    }
+
+    auto it = std::find(g_backgroundJobs.begin(),
+                        g_backgroundJobs.end(), this);
+    if (it != g_backgroundJobs.end())
+      g_backgroundJobs.erase(it);
   }
 
 private:
@@ -61,8 +175,14 @@ private:
       m_fop->setError("Error loading file:\n%s", e.what());
     }
 
-    if (m_fop->isStop() && m_fop->document())
+    m_fop->finishProgressiveLoad();
+
+    // Published documents are deleted from the UI thread (as they
+    // could be in the context already)
+    if (m_fop->isStop() && m_fop->document() &&
+        !m_fop->isDocumentPublished()) {
       delete m_fop->releaseDocument();
+    }
 
     m_fop->done();
   }
@@ -71,9 +191,119 @@ private:
     jobProgress(progress);
   }
 
+  virtual void onMonitoringTick() override {
+    if (!m_background && m_fop->isDocumentPublished()) {
+      try {
+        // The loading thread cannot modify the document while we add
+        // it to the context
+        const DocReader reader(m_fop->document(), 0);
+        add_loaded_document(m_context, m_fop);
+        m_notifiedFrames = m_fop->loadedFrames();
+      }
+      catch (const LockedDocException&) {
+        // The loading thread is decoding a frame, we'll try again in
+        // the next tick
+        Job::onMonitoringTick();
+        return;
+      }
+
+      m_background = true;
+      continueInBackground();
+      return;
+    }
+
+    Job::onMonitoringTick();
+  }
+
+  void onLoadingTick() {
+    if (!m_fop->isDone()) {
+      const doc::frame_t frames = m_fop->loadedFrames();
+      if (frames != m_notifiedFrames) {
+        Doc* doc = m_fop->document();
+        try {
+          const DocReader reader(doc, 0);
+          doc->notifyGeneralUpdate();
+          m_notifiedFrames = frames;
+        }
+        catch (const LockedDocException&) {
+          // Try again in the next tick
+        }
+      }
+      return;
+    }
+
+    // The loading thread has finished (and released the document)
+    m_loadingTimer->stop();
+    waitJob();
+
+    // The post-load process is done outside the Tick signal because
+    // it can ask things to the user (and we cannot delete the timer
+    // inside its own Tick signal)
+    ui::execute_from_ui_thread([this]{ onLoadFinished(); });
+  }
+
+  void onLoadFinished() {
+    if (m_stopped) {
+      delete this;
+      return;
+    }
+
+    Doc* doc = m_fop->document();
+
+    // Ask the user (e.g. what to do with the color profile) before
+    // locking the document
+    if (!m_askedPostLoad) {
+      m_fop->askPostLoad();
+      m_askedPostLoad = true;
+    }
+
+    try {
+      DocWriter writer(doc, 0);
+      m_fop->postLoad();
+      load_grid_bounds(m_context, m_fop);
+      doc->notifyGeneralUpdate();
+    }
+    catch (const LockedDocException&) {
+      // Other thread is reading the document, try again in the next
+      // tick
+      m_loadingTimer->start();
+      return;
+    }
+
+    m_fop->showPostLoadWarnings();
+
+    if (m_fop->hasError()) {
+      Console console;
+      console.printf(m_fop->error().c_str());
+    }
+
+    delete this;
+  }
+
+  Context* m_context;
   FileOp* m_fop;
+  std::unique_ptr<FileOp> m_fopOwner;
+  std::unique_ptr<ui::Timer> m_loadingTimer;
+  bool m_background;
+  bool m_stopped;
+  bool m_askedPostLoad;
+  doc::frame_t m_notifiedFrames;
 };
 
+bool stop_loading_document(Doc* doc)
+{
+  auto it = std::find_if(g_backgroundJobs.begin(),
+                         g_backgroundJobs.end(),
+                         [doc](const OpenFileJob* job){
+                           return job->document() == doc;
+                         });
+  if (it == g_backgroundJobs.end())
+    return false;
+
+  (*it)->stopLoading();
+  return true;
+}
+
 OpenFileCommand::OpenFileCommand()
   : Command(CommandId::OpenFile(), CmdRecordableFlag)
   , m_repeatCheckbox(false)
@@ -220,37 +450,36 @@ void OpenFileCommand::onExecute(Context* context)
         m_usedFiles.push_back(fn);
       }
 
-      OpenFileJob task(fop.get());
-      task.showProgressWindow();
+      // Display the document while it's being loaded only when the
+      // user opens the file directly (other commands, scripts, or the
+      // CLI expect the whole document loaded when this command ends).
+      if (context->isUIAvailable() &&
+          Context::commandFromMenuOrShortcut() == this &&
+          !fop->isSequence() &&
+          !fop->isOneFrame()) {
+        fop->setProgressive(true);
+      }
+
+      auto task = std::make_unique<OpenFileJob>(context, fop.get());
+      if (task->showProgressWindow()) {
+        // The document is already in the context, and the rest of
+        // frames are loaded in background (the task deletes itself)
+        task.release()->continueLoading(std::move(fop));
+        continue;
+      }
 
       // Post-load processing, it is called from the GUI because may require user intervention.
       fop->postLoad();
+      if (fop->isDocumentPublished())
+        fop->showPostLoadWarnings();
 
       // Show any error
       if (fop->hasError() && !fop->isStop())
         console.printf(fop->error().c_str());
 
-      Doc* doc = fop->document();
-      if (doc) {
-        if (context->isUIAvailable()) {
-          App::instance()->recentFiles()->addRecentFile(fop->filename().c_str());
-          auto& docPref = Preferences::instance().document(doc);
-
-          if (fop->hasEmbeddedGridBounds() &&
-              !doc->sprite()->gridBounds().isEmpty()) {
-            // If the sprite contains the grid bounds inside, we put
-            // those grid bounds into the settings (e.g. useful to
-            // interact with old versions of Aseprite saving the grid
-            // bounds in the aseprite.ini file)
-            docPref.grid.bounds(doc->sprite()->gridBounds());
-          }
-          else {
-            // Get grid bounds from preferences
-            doc->sprite()->setGridBounds(docPref.grid.bounds());
-          }
-        }
-
-        doc->setContext(context);
+      if (fop->document()) {
+        load_grid_bounds(context, fop.get());
+        add_loaded_document(context, fop.get());
       }
       else if (!fop->isStop())
         unrecent = true;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2021  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,7 @@
 #include <string>
 
 namespace app {
+  class Doc;
 
   class OpenFileCommand : public Command {
   public:
@@ -42,6 +43,13 @@ namespace app {
     gen::SequenceDecision m_seqDecision;
   };
 
+  // Stops loading the rest of frames of the given document if it's
+  // still being loaded in background (see FileOp::setProgressive()).
+  // Returns true if the load was stopped, in that case the document
+  // doesn't contain all the frames of its file and must be destroyed
+  // (not closed, so it cannot be reopened).
+  bool stop_loading_document(Doc* doc);
+
 } // namespace app
 
 #endif
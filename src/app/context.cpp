@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -140,6 +140,15 @@ void Context::notifyActiveSiteChanged()
   notify_observers<const Site&>(&ContextObserver::onActiveSiteChange, site);
 }
 
+// Command being executed from executeCommandFromMenuOrShortcut().
+static Command* g_commandFromMenuOrShortcut = nullptr;
+
+// static
+Command* Context::commandFromMenuOrShortcut()
+{
+  return g_commandFromMenuOrShortcut;
+}
+
 void Context::executeCommandFromMenuOrShortcut(Command* command, const Params& params)
 {
   ui::assert_ui_thread();
@@ -147,13 +156,12 @@ void Context::executeCommandFromMenuOrShortcut(Command* command, const Params& p
   // With this we avoid executing a command when we are inside another
   // command (e.g. if we press Cmd-S quickly the program can enter two
   // times in the File > Save command and hang).
-  static Command* executingCommand = nullptr;
-  if (executingCommand) {         // Ignore command execution
+  if (g_commandFromMenuOrShortcut) { // Ignore command execution
     LOG(VERBOSE, "CTXT: Ignoring command %s because we are inside %s\n",
-        command->id().c_str(), executingCommand->id().c_str());
+        command->id().c_str(), g_commandFromMenuOrShortcut->id().c_str());
     return;
   }
-  base::ScopedValue commandGuard(executingCommand, command);
+  base::ScopedValue commandGuard(g_commandFromMenuOrShortcut, command);
   executeCommand(command, params);
 }
 
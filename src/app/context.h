@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -121,6 +121,11 @@ namespace app {
     void notifyActiveSiteChanged();
 
     void executeCommandFromMenuOrShortcut(Command* command, const Params& params = Params());
+
+    // Returns the command executed directly by the user from a menu
+    // option or keyboard shortcut (even if it's executing other
+    // commands in this moment), or nullptr if there is no one.
+    static Command* commandFromMenuOrShortcut();
     virtual void executeCommand(Command* command, const Params& params = Params());
 
     void setCommandResult(const CommandResult& result);
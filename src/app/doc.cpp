@@ -38,8 +38,13 @@
 #include "os/window.h"
 #include "ui/system.h"
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #define DOC_TRACE(...) // TRACEARGS(__VA_ARGS__)
 
@@ -51,7 +56,7 @@ using namespace doc;
 Doc::Doc(Sprite* sprite)
   : m_ctx(nullptr)
   , m_flags(kMaskVisible)
-  , m_undo(new DocUndo)
+  , m_undo(new DocUndo(this))
   , m_transaction(nullptr)
   // Information about the file format used to load/save this document
   , m_format_options(nullptr)
@@ -327,6 +332,169 @@ void Doc::notifyAfterAddTile(LayerTilemap* layer, frame_t frame, tile_index ti)
   notify_observers<DocEvent&>(&DocObserver::onAfterAddTile, ev);
 }
 
+//////////////////////////////////////////////////////////////////////
+// Notifications batch
+
+namespace {
+
+using DocEventMethod = void (DocObserver::*)(DocEvent&);
+
+// Notifications that can be accumulated in a batch because the
+// modified object still exists when the batch is closed.
+const DocEventMethod kDeferrableNotifications[] = {
+  &DocObserver::onGeneralUpdate,
+  &DocObserver::onLayerNameChange,
+  &DocObserver::onLayerOpacityChange,
+  &DocObserver::onLayerBlendModeChange,
+  &DocObserver::onCelFrameChanged,
+  &DocObserver::onCelPositionChanged,
+  &DocObserver::onCelOpacityChange,
+  &DocObserver::onCelZIndexChange,
+  &DocObserver::onUserDataChange,
+  &DocObserver::onFrameDurationChanged,
+  &DocObserver::onImagePixelsModified,
+  &DocObserver::onSpritePixelsModified,
+  &DocObserver::onTagChange,
+  &DocObserver::onTagRename,
+  &DocObserver::onSliceNameChange,
+};
+
+// Notifications that are accumulated only in bulk edits. These are
+// merged by layer (observers only need to know which layers have
+// new cels).
+const DocEventMethod kBulkEditNotifications[] = {
+  &DocObserver::onAddCel,
+};
+
+} // anonymous namespace
+
+struct Doc::DeferredNotifications {
+  // Events with the same kind and the same source are merged
+  using Key = std::tuple<int, const void*, const void*, const void*,
+                         const void*, frame_t, const void*, const void*,
+                         const void*>;
+  struct Event {
+    DocEventMethod method;
+    DocEvent ev;
+    // False if the immediate observers didn't receive this event
+    // yet (bulk edit)
+    bool immediateSent;
+  };
+  std::map<Key, size_t> index;
+  std::vector<Event> events;
+};
+
+void Doc::beginNotificationsBatch()
+{
+  ++m_notificationsBatch;
+}
+
+void Doc::endNotificationsBatch()
+{
+  ASSERT(m_notificationsBatch > 0);
+  if (--m_notificationsBatch == 0 &&
+      m_deferredNotifications) {
+    sendDeferredNotifications();
+  }
+}
+
+void Doc::beginBulkEdit()
+{
+  ++m_bulkEdit;
+  beginNotificationsBatch();
+}
+
+void Doc::endBulkEdit()
+{
+  ASSERT(m_bulkEdit > 0);
+  --m_bulkEdit;
+  endNotificationsBatch();
+}
+
+void Doc::addImmediateObserver(DocObserver* observer)
+{
+  ASSERT(std::find(m_immediateObservers.begin(),
+                   m_immediateObservers.end(),
+                   observer) == m_immediateObservers.end());
+  m_immediateObservers.push_back(observer);
+}
+
+void Doc::removeImmediateObserver(DocObserver* observer)
+{
+  auto it = std::find(m_immediateObservers.begin(),
+                      m_immediateObservers.end(),
+                      observer);
+  ASSERT(it != m_immediateObservers.end());
+  if (it != m_immediateObservers.end())
+    m_immediateObservers.erase(it);
+}
+
+bool Doc::deferNotification(DocEventMethod method, DocEvent& ev)
+{
+  DeferredNotifications::Key key;
+
+  auto it = std::find(std::begin(kDeferrableNotifications),
+                      std::end(kDeferrableNotifications), method);
+  if (it != std::end(kDeferrableNotifications)) {
+    key = DeferredNotifications::Key(
+      int(it - std::begin(kDeferrableNotifications)),
+      ev.sprite(), ev.layer(), ev.cel(), ev.image(), ev.frame(),
+      ev.tag(), ev.slice(), ev.withUserData());
+  }
+  else if (m_bulkEdit > 0) {
+    auto it2 = std::find(std::begin(kBulkEditNotifications),
+                         std::end(kBulkEditNotifications), method);
+    if (it2 == std::end(kBulkEditNotifications))
+      return false;
+
+    key = DeferredNotifications::Key(
+      int(std::size(kDeferrableNotifications) +
+          (it2 - std::begin(kBulkEditNotifications))),
+      ev.sprite(), ev.layer(), nullptr, nullptr, 0,
+      nullptr, nullptr, nullptr);
+  }
+  else
+    return false;
+
+  if (!m_deferredNotifications)
+    m_deferredNotifications = std::make_unique<DeferredNotifications>();
+
+  auto& deferred = *m_deferredNotifications;
+  const bool immediateSent = (m_bulkEdit == 0);
+
+  auto indexIt = deferred.index.find(key);
+  if (indexIt != deferred.index.end()) {
+    auto& prev = deferred.events[indexIt->second];
+    prev.immediateSent &= immediateSent;
+
+    // Merge the modified region of pixels
+    if (!ev.region().isEmpty()) {
+      gfx::Region rgn = prev.ev.region();
+      rgn |= ev.region();
+      prev.ev.region(rgn);
+    }
+  }
+  else {
+    deferred.index[key] = deferred.events.size();
+    deferred.events.push_back({ method, ev, immediateSent });
+  }
+  return true;
+}
+
+void Doc::sendDeferredNotifications()
+{
+  // New notifications can be deferred while we send these ones
+  std::unique_ptr<DeferredNotifications> deferred;
+  std::swap(deferred, m_deferredNotifications);
+
+  for (auto& event : deferred->events) {
+    obs::observable<DocObserver>::notify_observers<DocEvent&>(
+      event.method, event.ev);
+    if (!event.immediateSent)
+      notifyImmediateObservers<DocEvent&>(event.method, event.ev);
+  }
+}
+
 bool Doc::isModified() const
 {
   return !m_undo->isInSavedStateOrSimilar();
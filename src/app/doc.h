@@ -25,9 +25,13 @@
 #include "obs/observable.h"
 #include "os/color_space.h"
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 namespace doc {
   class Cel;
@@ -134,6 +138,52 @@ namespace app {
     void notifyLayerGroupCollapseChange(Layer* layer);
     void notifyAfterAddTile(LayerTilemap* layer, frame_t frame, tile_index ti);
 
+    // While a batch of notifications is open, the notifications that
+    // just indicate that an existing object was modified (pixels, cel
+    // position/opacity, layer name/opacity, etc.) are accumulated
+    // (merging duplicated events and the regions of modified pixels)
+    // and sent when the last batch is closed. Other notifications
+    // (e.g. adding/removing objects) are sent immediately, after the
+    // accumulated ones, to keep the order of events.
+    //
+    // Each Transaction opens a batch until it's committed/rollbacked.
+    void beginNotificationsBatch();
+    void endNotificationsBatch();
+    bool isBatchingNotifications() const { return m_notificationsBatch > 0; }
+
+    // Immediate observers receive all notifications as soon as they
+    // are generated, even inside a batch (e.g. the DocView must show
+    // the painted pixels while the user is drawing in the editor).
+    // They must not be added with add_observer() too.
+    void addImmediateObserver(DocObserver* observer);
+    void removeImmediateObserver(DocObserver* observer);
+
+    // A bulk edit is a batch of notifications where the immediate
+    // observers have to wait too, and where the onAddCel()
+    // notifications are accumulated (merged by layer). Used by
+    // scripts in app.transaction() to create thousands of cels
+    // without updating the UI in each step.
+    void beginBulkEdit();
+    void endBulkEdit();
+    bool isBulkEditing() const { return m_bulkEdit > 0; }
+
+    // Hides obs::observable::notify_observers() to accumulate the
+    // notifications while a batch is open.
+    template<typename ...Args>
+    void notify_observers(void (DocObserver::*method)(Args...), Args ...args) {
+      if constexpr (std::is_same_v<std::tuple<Args...>, std::tuple<DocEvent&>>) {
+        if (m_notificationsBatch > 0 && deferNotification(method, args...)) {
+          if (m_bulkEdit == 0)
+            notifyImmediateObservers<Args...>(method, args...);
+          return;
+        }
+      }
+      if (m_deferredNotifications)
+        sendDeferredNotifications();
+      obs::observable<DocObserver>::notify_observers<Args...>(method, args...);
+      notifyImmediateObservers<Args...>(method, args...);
+    }
+
     //////////////////////////////////////////////////////////////////////
     // File related properties
 
@@ -252,8 +302,29 @@ namespace app {
     virtual void onContextChanged();
 
   private:
+    struct DeferredNotifications;
+
     void removeFromContext();
     void updateOSColorSpace(bool appWideSignal);
+    bool deferNotification(void (DocObserver::*method)(DocEvent&), DocEvent& ev);
+    void sendDeferredNotifications();
+
+    template<typename ...Args>
+    void notifyImmediateObservers(void (DocObserver::*method)(Args...), Args ...args) {
+      if (m_immediateObservers.empty())
+        return;
+
+      // Iterate a copy because observers can be removed in the
+      // notification itself.
+      const std::vector<DocObserver*> observers = m_immediateObservers;
+      for (DocObserver* observer : observers) {
+        if (std::find(m_immediateObservers.begin(),
+                      m_immediateObservers.end(),
+                      observer) != m_immediateObservers.end()) {
+          (observer->*method)(args...);
+        }
+      }
+    }
 
     // The document is in the collection of documents of this context.
     Context* m_ctx;
@@ -291,9 +362,49 @@ namespace app {
     // Last used color space to render a sprite.
     os::ColorSpaceRef m_osColorSpace;
 
+    // Number of open batches of notifications and the accumulated
+    // notifications (see beginNotificationsBatch()).
+    int m_notificationsBatch = 0;
+    int m_bulkEdit = 0;
+    std::unique_ptr<DeferredNotifications> m_deferredNotifications;
+
+    // Observers that don't want to wait the end of a batch of
+    // notifications (see addImmediateObserver()).
+    std::vector<DocObserver*> m_immediateObservers;
+
     DISABLE_COPYING(Doc);
   };
 
+  // Opens a batch of notifications in the given document during the
+  // lifetime of this object (see Doc::beginNotificationsBatch()).
+  class DocNotificationsBatch {
+  public:
+    DocNotificationsBatch(Doc* doc) : m_doc(doc) {
+      m_doc->beginNotificationsBatch();
+    }
+    ~DocNotificationsBatch() {
+      m_doc->endNotificationsBatch();
+    }
+  private:
+    Doc* m_doc;
+    DISABLE_COPYING(DocNotificationsBatch);
+  };
+
+  // Bulk edit of the given document during the lifetime of this
+  // object (see Doc::beginBulkEdit()).
+  class DocBulkEdit {
+  public:
+    DocBulkEdit(Doc* doc) : m_doc(doc) {
+      m_doc->beginBulkEdit();
+    }
+    ~DocBulkEdit() {
+      m_doc->endBulkEdit();
+    }
+  private:
+    Doc* m_doc;
+    DISABLE_COPYING(DocBulkEdit);
+  };
+
 } // namespace app
 
 #endif
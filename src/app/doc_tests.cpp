@@ -0,0 +1,172 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/cmd/set_layer_opacity.h"
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/doc_event.h"
+#include "app/doc_observer.h"
+#include "app/test_context.h"
+#include "app/tx.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+#include <string>
+#include <vector>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+class EventsRecorder : public DocObserver {
+public:
+  std::vector<std::string> events;
+  gfx::Region region;
+
+  void onAddLayer(DocEvent& ev) override {
+    events.push_back("addLayer");
+  }
+  void onAddCel(DocEvent& ev) override {
+    events.push_back("addCel");
+  }
+  void onLayerOpacityChange(DocEvent& ev) override {
+    events.push_back("opacity");
+  }
+  void onSpritePixelsModified(DocEvent& ev) override {
+    events.push_back("pixels");
+    region = ev.region();
+  }
+};
+
+} // anonymous namespace
+
+TEST(Doc, NotificationsBatch)
+{
+  TestContextT<Context> ctx;
+  std::unique_ptr<Doc> doc(ctx.documents().add(32, 16));
+  Sprite* sprite = doc->sprite();
+  EventsRecorder rec;
+  doc->add_observer(&rec);
+
+  DocEvent ev(doc.get());
+  ev.sprite(sprite);
+  ev.layer(sprite->root()->firstLayer());
+  {
+    DocNotificationsBatch batch(doc.get());
+    EXPECT_TRUE(doc->isBatchingNotifications());
+
+    doc->notify_observers<DocEvent&>(&DocObserver::onLayerOpacityChange, ev);
+    doc->notify_observers<DocEvent&>(&DocObserver::onLayerOpacityChange, ev);
+    doc->notifySpritePixelsModified(sprite, gfx::Region(gfx::Rect(0, 0, 4, 4)), 0);
+    doc->notifySpritePixelsModified(sprite, gfx::Region(gfx::Rect(8, 8, 4, 4)), 0);
+    EXPECT_TRUE(rec.events.empty());
+
+    // Adding objects is notified immediately, after the accumulated
+    // (and merged) notifications
+    doc->notify_observers<DocEvent&>(&DocObserver::onAddLayer, ev);
+    ASSERT_EQ(3, rec.events.size());
+    EXPECT_EQ("opacity", rec.events[0]);
+    EXPECT_EQ("pixels", rec.events[1]);
+    EXPECT_EQ("addLayer", rec.events[2]);
+    EXPECT_EQ(gfx::Rect(0, 0, 12, 12), rec.region.bounds());
+
+    rec.events.clear();
+    doc->notify_observers<DocEvent&>(&DocObserver::onLayerOpacityChange, ev);
+    EXPECT_TRUE(rec.events.empty());
+  }
+  EXPECT_FALSE(doc->isBatchingNotifications());
+  ASSERT_EQ(1, rec.events.size());
+  EXPECT_EQ("opacity", rec.events[0]);
+
+  doc->remove_observer(&rec);
+  doc->close();
+}
+
+TEST(Doc, TransactionNotificationsBatch)
+{
+  TestContextT<Context> ctx;
+  std::unique_ptr<Doc> doc(ctx.documents().add(32, 16));
+  Sprite* sprite = doc->sprite();
+  auto layer = static_cast<LayerImage*>(sprite->root()->firstLayer());
+  EventsRecorder rec, immediateRec;
+  doc->add_observer(&rec);
+  doc->addImmediateObserver(&immediateRec);
+  {
+    Tx tx(sprite, "");
+    tx(new cmd::SetLayerOpacity(layer, 128));
+    tx(new cmd::SetLayerOpacity(layer, 64));
+    EXPECT_TRUE(doc->isBatchingNotifications());
+    EXPECT_TRUE(rec.events.empty());
+    EXPECT_EQ(2, immediateRec.events.size());
+    tx.commit();
+  }
+  EXPECT_FALSE(doc->isBatchingNotifications());
+  ASSERT_EQ(1, rec.events.size());
+  EXPECT_EQ("opacity", rec.events[0]);
+  EXPECT_EQ(2, immediateRec.events.size());
+
+  // Rollback
+  rec.events.clear();
+  {
+    Tx tx(sprite, "");
+    tx(new cmd::SetLayerOpacity(layer, 32));
+    EXPECT_TRUE(rec.events.empty());
+  }
+  EXPECT_FALSE(doc->isBatchingNotifications());
+  ASSERT_EQ(1, rec.events.size());
+  EXPECT_EQ(64, layer->opacity());
+
+  doc->removeImmediateObserver(&immediateRec);
+  doc->remove_observer(&rec);
+  doc->close();
+}
+
+TEST(Doc, BulkEdit)
+{
+  TestContextT<Context> ctx;
+  std::unique_ptr<Doc> doc(ctx.documents().add(32, 16));
+  Sprite* sprite = doc->sprite();
+  EventsRecorder rec, immediateRec;
+  doc->add_observer(&rec);
+  doc->addImmediateObserver(&immediateRec);
+
+  DocEvent ev(doc.get());
+  ev.sprite(sprite);
+  ev.layer(sprite->root()->firstLayer());
+  {
+    DocBulkEdit bulkEdit(doc.get());
+    EXPECT_TRUE(doc->isBulkEditing());
+
+    for (int i=0; i<3; ++i) {
+      doc->notify_observers<DocEvent&>(&DocObserver::onLayerOpacityChange, ev);
+      doc->notify_observers<DocEvent&>(&DocObserver::onAddCel, ev);
+    }
+    EXPECT_TRUE(rec.events.empty());
+    EXPECT_TRUE(immediateRec.events.empty());
+  }
+  EXPECT_FALSE(doc->isBulkEditing());
+  EXPECT_FALSE(doc->isBatchingNotifications());
+  for (auto* r : { &rec, &immediateRec }) {
+    ASSERT_EQ(2, r->events.size());
+    EXPECT_EQ("opacity", r->events[0]);
+    EXPECT_EQ("addCel", r->events[1]);
+  }
+
+  // onAddCel is not accumulated in regular batches
+  rec.events.clear();
+  {
+    DocNotificationsBatch batch(doc.get());
+    doc->notify_observers<DocEvent&>(&DocObserver::onAddCel, ev);
+    EXPECT_EQ(1, rec.events.size());
+  }
+
+  doc->removeImmediateObserver(&immediateRec);
+  doc->remove_observer(&rec);
+  doc->close();
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,7 @@
 #include "app/cmd_transaction.h"
 #include "app/console.h"
 #include "app/context.h"
+#include "app/doc.h"
 #include "app/doc_undo_observer.h"
 #include "app/pref/preferences.h"
 #include "base/mem_utils.h"
@@ -31,8 +32,9 @@
 
 namespace app {
 
-DocUndo::DocUndo()
-  : m_undoHistory(this)
+DocUndo::DocUndo(Doc* doc)
+  : m_doc(doc)
+  , m_undoHistory(this)
 {
 }
 
@@ -112,7 +114,10 @@ void DocUndo::undo()
     ASSERT(state);
     const Cmd* cmd = STATE_CMD(state);
     m_totalUndoSize -= cmd->memSize();
-    m_undoHistory.undo();
+    {
+      DocNotificationsBatch batch(m_doc);
+      m_undoHistory.undo();
+    }
     m_totalUndoSize += cmd->memSize();
   }
   // This notification could execute a script that modifies the sprite
@@ -134,7 +139,10 @@ void DocUndo::redo()
     ASSERT(state);
     const Cmd* cmd = STATE_CMD(state);
     m_totalUndoSize -= cmd->memSize();
-    m_undoHistory.redo();
+    {
+      DocNotificationsBatch batch(m_doc);
+      m_undoHistory.redo();
+    }
     m_totalUndoSize += cmd->memSize();
   }
   notify_observers(&DocUndoObserver::onCurrentUndoStateChange, this);
@@ -281,7 +289,15 @@ void DocUndo::moveToState(const undo::UndoState* state)
   ASSERT(!m_undoing);
   base::ScopedValue undoing(m_undoing, true);
 
-  m_undoHistory.moveTo(state);
+  // All the commands between the current state and the given state
+  // are undone/redone, the notifications of these commands are
+  // accumulated and sent together at the end (e.g. if we jump
+  // several states, the same modified cel will be notified just one
+  // time).
+  {
+    DocNotificationsBatch batch(m_doc);
+    m_undoHistory.moveTo(state);
+  }
 
   // After onCurrentUndoStateChange don't use the "state" argument, it
   // might be deleted because some script might have modified the
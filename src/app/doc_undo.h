@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -25,6 +25,7 @@ namespace app {
   class Cmd;
   class CmdTransaction;
   class Context;
+  class Doc;
   class DocUndoObserver;
 
   // Exception thrown when we want to modify the sprite (add new
@@ -39,7 +40,7 @@ namespace app {
   class DocUndo : public obs::observable<DocUndoObserver>,
                   public undo::UndoHistoryDelegate {
   public:
-    DocUndo();
+    DocUndo(Doc* doc);
 
     size_t totalUndoSize() const { return m_totalUndoSize; }
 
@@ -107,6 +108,7 @@ namespace app {
     // undo::UndoHistoryDelegate impl
     void onDeleteUndoState(undo::UndoState* state) override;
 
+    Doc* m_doc;
     undo::UndoHistory m_undoHistory;
     const undo::UndoState* m_savedState = nullptr;
     Context* m_ctx = nullptr;
@@ -24,6 +24,7 @@
 #include "dio/decode_delegate.h"
 #include "dio/file_interface.h"
 #include "doc/doc.h"
+#include "doc/user_data_io.h"
 #include "fixmath/fixmath.h"
 #include "fmt/format.h"
 #include "ui/alert.h"
@@ -31,7 +32,11 @@
 #include "zlib.h"
 
 #include <cstdio>
+#include <cstring>
 #include <deque>
+#include <sstream>
+#include <string>
+#include <unordered_map>
 #include <variant>
 
 #define ASEFILE_TRACE(...) // TRACE(__VA_ARGS__)
@@ -42,6 +47,22 @@ using namespace base;
 
 namespace {
 
+void create_document(FileOp* fop, Sprite* sprite)
+{
+  fop->createDocument(sprite);
+
+  if (sprite->colorSpace() != nullptr &&
+      sprite->colorSpace()->type() != gfx::ColorSpace::None) {
+    fop->setEmbeddedColorProfile();
+  }
+
+  // Sprite grid bounds will be set to empty (instead of
+  // doc::Sprite::DefaultGridBounds()) if the file doesn't contain an
+  // embedded grid bounds.
+  if (!sprite->gridBounds().isEmpty())
+    fop->setEmbeddedGridBounds();
+}
+
 class DecodeDelegate : public dio::DecodeDelegate {
 public:
   DecodeDelegate(FileOp* fop)
@@ -70,6 +91,18 @@ public:
     return m_fop->isOneFrame();
   }
 
+  bool decodeProgressively() override {
+    return m_fop->isProgressive();
+  }
+
+  void onBeginFrame(doc::frame_t frame) override {
+    m_fop->beginFrame(frame);
+  }
+
+  void onEndFrame(doc::frame_t frame) override {
+    m_fop->endFrame(frame);
+  }
+
   doc::color_t defaultSliceColor() override {
     auto color = m_fop->config().defaultSliceColor;
     return doc::rgba(color.getRed(),
@@ -80,6 +113,13 @@ public:
 
   void onSprite(doc::Sprite* sprite) override {
     m_sprite = sprite;
+
+    // The rest of frames will be decoded in this same sprite, so we
+    // can show the document right now.
+    if (m_fop->isProgressive()) {
+      create_document(m_fop, sprite);
+      m_fop->publishDocument();
+    }
   }
 
   doc::Sprite* sprite() { return m_sprite; }
@@ -88,6 +128,10 @@ public:
     return m_fop->config().cacheCompressedTilesets;
   }
 
+  bool shareReferencedImages() const override {
+    return m_fop->config().shareReferencedImages;
+  }
+
 private:
   FileOp* m_fop;
   doc::Sprite* m_sprite;
@@ -142,6 +186,56 @@ public:
   }
 };
 
+// Keeps track of the images already saved in the file, so cels with
+// identical pixels (but not linked) can be saved as references to the
+// first saved cel (ASE_FILE_IMAGE_REF_CEL) instead of compressing and
+// storing the same image again.
+class SavedImages {
+public:
+  struct Item {
+    const Image* image;
+    layer_t layerIndex;
+    frame_t frame;
+  };
+
+  // Returns the first saved cel with the same pixels as the given
+  // image, or nullptr if there is no such cel (in that case the
+  // image is added to the table).
+  const Item* findOrAdd(const Image* image,
+                        const layer_t layerIndex,
+                        const frame_t frame) {
+    const uint32_t hash = calculate_image_hash(image, image->bounds());
+    auto range = m_items.equal_range(hash);
+    for (auto it=range.first; it!=range.second; ++it) {
+      if (isSameImageData(it->second.image, image))
+        return &it->second;
+    }
+    m_items.insert(std::make_pair(hash, Item{ image, layerIndex, frame }));
+    return nullptr;
+  }
+
+private:
+  // We compare the exact bytes (is_same_image() considers all
+  // transparent pixels equal, but we cannot lose the RGB values of
+  // those pixels).
+  static bool isSameImageData(const Image* a, const Image* b) {
+    if (a->pixelFormat() != b->pixelFormat() ||
+        a->width() != b->width() ||
+        a->height() != b->height())
+      return false;
+
+    const int widthBytes = a->widthBytes();
+    for (int y=0; y<a->height(); ++y) {
+      if (std::memcmp(a->getPixelAddress(0, y),
+                      b->getPixelAddress(0, y), widthBytes) != 0)
+        return false;
+    }
+    return true;
+  }
+
+  std::unordered_multimap<uint32_t, Item> m_items;
+};
+
 } // anonymous namespace
 
 static void ase_file_prepare_header(FILE* f, dio::AsepriteHeader* header, const Sprite* sprite,
@@ -159,6 +253,7 @@ static void ase_file_write_layers(FILE* f, FileOp* fop,
 static layer_t ase_file_write_cels(FILE* f,  FileOp* fop,
                                    dio::AsepriteFrameHeader* frame_header,
                                    const dio::AsepriteExternalFiles& ext_files,
+                                   SavedImages* savedImages,
                                    const Sprite* sprite, const Layer* layer,
                                    layer_t layer_index,
                                    const frame_t frame);
@@ -173,6 +268,8 @@ static void ase_file_write_color2_chunk(FILE* f, dio::AsepriteFrameHeader* frame
 static void ase_file_write_palette_chunk(FILE* f, dio::AsepriteFrameHeader* frame_header, const Palette* pal, int from, int to);
 static void ase_file_write_layer_chunk(FILE* f, dio::AsepriteFrameHeader* frame_header, const Layer* layer, int child_level);
 static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_header,
+                                     SavedImages* savedImages,
+                                     const bool cacheCompressedCels,
                                      const Cel* cel,
                                      const LayerImage* layer,
                                      const layer_t layer_index,
@@ -289,20 +386,9 @@ bool AseFormat::onLoad(FileOp* fop)
   if (!decoder.decode())
     return false;
 
-  Sprite* sprite = delegate.sprite();
-  fop->createDocument(sprite);
-
-  if (sprite->colorSpace() != nullptr &&
-      sprite->colorSpace()->type() != gfx::ColorSpace::None) {
-    fop->setEmbeddedColorProfile();
-  }
-
-  // Sprite grid bounds will be set to empty (instead of
-  // doc::Sprite::DefaultGridBounds()) if the file doesn't contain an
-  // embedded grid bounds.
-  if (!sprite->gridBounds().isEmpty())
-    fop->setEmbeddedGridBounds();
-
+  // The document is already created if it was loaded progressively
+  if (!fop->document())
+    create_document(fop, delegate.sprite());
   return true;
 }
 
@@ -361,6 +447,11 @@ bool AseFormat::onSave(FileOp* fop)
     }
   }
 
+  // Table of saved images to find cels with identical pixels
+  std::unique_ptr<SavedImages> savedImages;
+  if (fop->config().dedupCelImages)
+    savedImages = std::make_unique<SavedImages>();
+
   // Write frames
   int outputFrame = 0;
   dio::AsepriteExternalFiles ext_files;
@@ -439,6 +530,7 @@ bool AseFormat::onSave(FileOp* fop)
 
     // Write cel chunks
     ase_file_write_cels(f, fop, &frame_header, ext_files,
+                        savedImages.get(),
                         sprite, sprite->root(),
                         0, frame);
 
@@ -586,6 +678,7 @@ static void ase_file_write_layers(FILE* f, FileOp* fop,
 static layer_t ase_file_write_cels(FILE* f, FileOp* fop,
                                    dio::AsepriteFrameHeader* frame_header,
                                    const dio::AsepriteExternalFiles& ext_files,
+                                   SavedImages* savedImages,
                                    const Sprite* sprite, const Layer* layer,
                                    layer_t layer_index,
                                    const frame_t frame)
@@ -593,7 +686,8 @@ static layer_t ase_file_write_cels(FILE* f, FileOp* fop,
   if (layer->isImage()) {
     const Cel* cel = layer->cel(frame);
     if (cel) {
-      ase_file_write_cel_chunk(f, frame_header, cel,
+      ase_file_write_cel_chunk(f, frame_header, savedImages,
+                               fop->config().cacheCompressedCels, cel,
                                static_cast<const LayerImage*>(layer),
                                layer_index, sprite, fop->roi().fromFrame());
 
@@ -614,8 +708,8 @@ static layer_t ase_file_write_cels(FILE* f, FileOp* fop,
   if (layer->isGroup()) {
     for (const Layer* child : static_cast<const LayerGroup*>(layer)->layers()) {
       layer_index =
-        ase_file_write_cels(f, fop, frame_header, ext_files, sprite, child,
-                            layer_index, frame);
+        ase_file_write_cels(f, fop, frame_header, ext_files, savedImages,
+                            sprite, child, layer_index, frame);
     }
   }
 
@@ -959,6 +1053,8 @@ static void write_compressed_image(FILE* f,
 //////////////////////////////////////////////////////////////////////
 
 static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_header,
+                                     SavedImages* savedImages,
+                                     const bool cacheCompressedCels,
                                      const Cel* cel,
                                      const LayerImage* layer,
                                      const layer_t layer_index,
@@ -982,7 +1078,20 @@ static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_he
       link = nullptr;
   }
 
+  // Check if other cel (not linked) with the same pixels was already
+  // saved, to reference its image.
+  const SavedImages::Item* ref = nullptr;
+  if (!link &&
+      savedImages &&
+      !cel->layer()->isTilemap() &&
+      cel->image()) {
+    ref = savedImages->findOrAdd(cel->image(),
+                                 layer_index,
+                                 cel->frame()-firstFrame);
+  }
+
   int cel_type = (link ? ASE_FILE_LINK_CEL:
+                  ref ? ASE_FILE_IMAGE_REF_CEL:
                   cel->layer()->isTilemap() ? ASE_FILE_COMPRESSED_TILEMAP:
                                               ASE_FILE_COMPRESSED_CEL);
 
@@ -1021,6 +1130,12 @@ static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_he
       fputw(link->frame()-firstFrame, f);
       break;
 
+    case ASE_FILE_IMAGE_REF_CEL:
+      // Cel with the same image as other layer/frame
+      fputw(ref->layerIndex, f);
+      fputw(ref->frame, f);
+      break;
+
     case ASE_FILE_COMPRESSED_CEL: {
       const Image* image = cel->image();
       ASSERT(image);
@@ -1029,8 +1144,33 @@ static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_he
         fputw(image->width(), f);
         fputw(image->height(), f);
 
-        ImageScanlines scan(image);
-        write_compressed_image(f, &scan, image->pixelFormat());
+        // Save the cached compressed data if the image didn't change
+        // since the last time it was saved
+        const uint32_t hash =
+          (cacheCompressedCels ? calculate_image_hash(image, image->bounds()): 0);
+        if (cacheCompressedCels &&
+            !image->compressedData().empty() &&
+            image->compressedDataVersion() == image->version() &&
+            image->compressedDataHash() == hash) {
+          const base::buffer& data = image->compressedData();
+
+          ASEFILE_TRACE("[%d] saving compressed cel image (%s)\n",
+                        image->id(), base::get_pretty_memory_size(data.size()).c_str());
+
+          if (fwrite(&data[0], 1, data.size(), f) != data.size() || ferror(f))
+            throw base::Exception("Error writing compressed image pixels.\n");
+        }
+        else {
+          ImageScanlines scan(image);
+          base::buffer compressedData;
+          write_compressed_image(f, &scan, image->pixelFormat(),
+                                 (cacheCompressedCels ? &compressedData: nullptr));
+
+          if (cacheCompressedCels)
+            image->setCompressedData(std::move(compressedData), hash);
+          else
+            image->discardCompressedData();
+        }
       }
       else {
         // Width and height
@@ -1321,9 +1461,11 @@ static void ase_file_write_external_files_chunk(
   dio::AsepriteExternalFiles& ext_files,
   const Sprite* sprite)
 {
-  auto putExtentionIds = [](const UserData::PropertiesMaps& propertiesMaps,
+  // The user data is received as const to avoid copying shared
+  // properties (see UserData::propertiesMaps()).
+  auto putExtentionIds = [](const UserData& userData,
                             dio::AsepriteExternalFiles& ext_files) {
-      for (auto propertiesMap : propertiesMaps) {
+      for (const auto& propertiesMap : userData.propertiesMaps()) {
         if (!propertiesMap.first.empty())
           ext_files.insert(ASE_EXTERNAL_FILE_EXTENSION,
                            propertiesMap.first);
@@ -1339,18 +1481,17 @@ static void ase_file_write_external_files_chunk(
                        tileset->externalFilename());
     }
 
-    putExtentionIds(tileset->userData().propertiesMaps(), ext_files);
+    putExtentionIds(tileset->userData(), ext_files);
 
     for (tile_index i=0; i < tileset->size(); ++i) {
-      UserData tileData = tileset->getTileData(i);
-      putExtentionIds(tileData.propertiesMaps(), ext_files);
+      putExtentionIds(tileset->getTileData(i), ext_files);
     }
   }
 
-  putExtentionIds(sprite->userData().propertiesMaps(), ext_files);
+  putExtentionIds(sprite->userData(), ext_files);
 
   for (doc::Tag* tag : sprite->tags()) {
-    putExtentionIds(tag->userData().propertiesMaps(), ext_files);
+    putExtentionIds(tag->userData(), ext_files);
   }
 
   // Go through all the layers collecting all the extension IDs we find
@@ -1359,7 +1500,7 @@ static void ase_file_write_external_files_chunk(
     auto layer = layers.front();
     layers.pop_front();
 
-    putExtentionIds(layer->userData().propertiesMaps(), ext_files);
+    putExtentionIds(layer->userData(), ext_files);
     if (layer->isGroup()) {
       auto childLayers = static_cast<const LayerGroup*>(layer)->layers();
       layers.insert(layers.end(), childLayers.begin(), childLayers.end());
@@ -1368,7 +1509,7 @@ static void ase_file_write_external_files_chunk(
       for (frame_t frame : fop->roi().framesSequence()) {
         const Cel* cel = layer->cel(frame);
         if (cel && !cel->link()) {
-          putExtentionIds(cel->data()->userData().propertiesMaps(), ext_files);
+          putExtentionIds(cel->data()->userData(), ext_files);
         }
       }
     }
@@ -1379,7 +1520,7 @@ static void ase_file_write_external_files_chunk(
     if (slice->range(fop->roi().fromFrame(), fop->roi().toFrame()).empty())
       continue;
 
-    putExtentionIds(slice->userData().propertiesMaps(), ext_files);
+    putExtentionIds(slice->userData(), ext_files);
   }
 
   // Tile management plugin
@@ -1417,8 +1558,24 @@ static void ase_file_write_tileset_chunks(FILE* f, FileOp* fop,
       ase_file_write_user_data_chunk(f, fop, frame_header, ext_files, &tileset->userData());
 
       // Write tile UserData
+      std::unordered_map<std::string, tile_index> savedTileData;
       for (tile_index i=0; i < tileset->size(); ++i) {
-        UserData tileData = tileset->getTileData(i);
+        const UserData& tileData = tileset->getTileData(i);
+
+        // Tiles with the same user data as a previous tile are saved
+        // as a reference to that tile.
+        if (fop->config().dedupTileUserData && !tileData.isEmpty()) {
+          std::ostringstream os;
+          doc::write_user_data(os, tileData);
+          auto result = savedTileData.try_emplace(os.str(), i);
+          if (!result.second) {
+            ChunkWriter chunk(f, frame_header, ASE_FILE_CHUNK_USER_DATA);
+            fputl(ASE_USER_DATA_FLAG_SAME_AS_TILE, f);
+            fputl(result.first->second, f);
+            continue;
+          }
+        }
+
         ase_file_write_user_data_chunk(f, fop, frame_header, ext_files, &tileData);
       }
     }
@@ -19,11 +19,14 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/file/pixel_rows.h"
 #include "base/cfile.h"
 #include "base/file_handle.h"
 #include "doc/doc.h"
 #include "fmt/format.h"
 
+#include <vector>
+
 namespace app {
 
 // Max supported .bmp size (to filter out invalid image sizes)
@@ -1205,7 +1208,7 @@ bool BmpFormat::onSave(FileOp *fop)
   }
 
   int filler = int((32 - ((w*bpp-1) & 31)-1) / 8);
-  int c, i, j, r, g, b;
+  int i, r, g, b;
 
   if (bpp <= 8) {
     biSizeImage = (w + filler)*bpp/8 * h;
@@ -1285,55 +1288,35 @@ bool BmpFormat::onSave(FileOp *fop)
     }
   }
 
-  // Only used in indexed mode
-  int colorsPerByte = std::max(1, 8/bpp);
-  int colorMask;
-  switch (bpp) {
-    case 8: colorMask = 0xFF; break;
-    case 4: colorMask = 0x0F; break;
-    case 1: colorMask = 0x01; break;
-    default: colorMask = 0; break;
-  }
+  // Each scanline is converted to the file layout in this buffer
+  // (including the padding bytes) and written with one fwrite() call.
+  const int rowBytes = (bpp <= 8 ? (w*bpp+7)/8: w*bpp/8) + filler;
+  std::vector<uint8_t> row(rowBytes, 0);
 
   // Save image pixels (from bottom to top)
   for (i=h-1; i>=0; i--) {
     switch (spec.colorMode()) {
       case ColorMode::RGB: {
         auto scanline = (const uint32_t*)img->getScanline(i);
-        for (j=0; j<w; ++j) {
-          c = scanline[j];
-          fputc(rgba_getb(c), f);
-          fputc(rgba_getg(c), f);
-          fputc(rgba_getr(c), f);
-          if (withAlpha)
-            fputc(rgba_geta(c), f);
-        }
+        if (withAlpha)
+          rgba_row_to_bgra(scanline, row.data(), w);
+        else
+          rgba_row_to_bgr(scanline, row.data(), w);
         break;
       }
       case ColorMode::GRAYSCALE: {
         auto scanline = (const uint16_t*)img->getScanline(i);
-        for (j=0; j<w; ++j) {
-          c = scanline[j];
-          fputc(graya_getv(c), f);
-        }
+        graya_row_to_gray(scanline, row.data(), w);
         break;
       }
       case ColorMode::INDEXED: {
         auto scanline = (const uint8_t*)img->getScanline(i);
-        for (j=0; j<w; ) {
-          uint8_t value = 0;
-          for (int k=colorsPerByte-1; k>=0 && j<w; --k, ++j) {
-            c = scanline[j];
-            value |= (c & colorMask) << (bpp*k);
-          }
-          fputc(value, f);
-        }
+        pack_indexed_row(scanline, row.data(), w, bpp);
         break;
       }
     }
 
-    for (j=0; j<filler; j++)
-      fputc(0, f);
+    fwrite(row.data(), 1, rowBytes, f);
 
     fop->setProgress((float)(h-i) / (float)h);
   }
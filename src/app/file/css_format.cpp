@@ -21,8 +21,12 @@
 #include "base/file_handle.h"
 #include "base/string.h"
 #include "doc/doc.h"
+#include "fmt/format.h"
 #include "ui/window.h"
 
+#include <iterator>
+#include <string>
+
 #include "css_options.xml.h"
 
 
@@ -93,68 +97,86 @@ bool CssFormat::onSave(FileOp* fop)
   const auto css_options = std::static_pointer_cast<CssOptions>(fop->formatOptions());
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
   FILE* f = handle.get();
-  auto print_color = [f](int r, int g, int b, int a) {
+
+  // Output is accumulated in this buffer and written in big blocks
+  // (instead of calling fprintf() for each pixel).
+  constexpr std::size_t kBufferSize = 64*1024;
+  std::string buf;
+  buf.reserve(kBufferSize);
+  auto out = std::back_inserter(buf);
+  auto flush = [f, &buf]() {
+    fwrite(buf.data(), 1, buf.size(), f);
+    buf.clear();
+  };
+
+  auto print_color = [out](int r, int g, int b, int a) {
     if (a == 255) {
-      fprintf(f, "#%02X%02X%02X", r, g, b);
+      fmt::format_to(out, "#{:02X}{:02X}{:02X}", r, g, b);
     }
     else {
-      fprintf(f, "rgba(%d, %d, %d, %d)", r, g, b, a);
+      fmt::format_to(out, "rgba({}, {}, {}, {})", r, g, b, a);
     }
   };
-  auto print_shadow_color = [f, css_options, print_color](int x, int y, int r,
-                                                          int g, int b, int a,
-                                                          bool comma = true) {
-    fprintf(f, comma?",\n":"\n");
+  auto print_shadow_color = [&buf, out, css_options, print_color](int x, int y, int r,
+                                                                  int g, int b, int a,
+                                                                  bool comma = true) {
+    buf += (comma ? ",\n": "\n");
     if (css_options->withVars) {
-      fprintf(f, "\tcalc(%d*var(--shadow-mult)) calc(%d*var(--shadow-mult)) var(--blur) var(--spread) ",
-              x, y);
+      fmt::format_to(out, "\tcalc({}*var(--shadow-mult)) calc({}*var(--shadow-mult)) var(--blur) var(--spread) ",
+                     x, y);
     }
     else {
       int x_loc = x * (css_options->pixelScale + css_options->gutterSize);
       int y_loc = y * (css_options->pixelScale + css_options->gutterSize);
-      fprintf(f, "%dpx %dpx ", x_loc, y_loc);
+      fmt::format_to(out, "{}px {}px ", x_loc, y_loc);
     }
     print_color(r, g, b, a);
   };
-  auto print_shadow_index = [f, css_options](int x, int y, int i, bool comma=true) {
-    fprintf(f, comma?",\n":"\n");
-    fprintf(f, "\tcalc(%d*var(--shadow-mult)) calc(%d*var(--shadow-mult)) var(--blur) var(--spread) var(--color-%d)",
-            x, y, i);
+  auto print_shadow_index = [&buf, out](int x, int y, int i, bool comma=true) {
+    buf += (comma ? ",\n": "\n");
+    fmt::format_to(out, "\tcalc({}*var(--shadow-mult)) calc({}*var(--shadow-mult)) var(--blur) var(--spread) var(--color-{})",
+                   x, y, i);
+  };
+  auto end_row = [&]() {
+    if (buf.size() >= kBufferSize)
+      flush();
+    fop->setProgress((float)y / (float)(image->height()));
   };
   if (css_options->withVars) {
-    fprintf(f, ":root {\n"
-               "\t--blur: 0px;\n"
-               "\t--spread: 0px;\n"
-               "\t--pixel-size: %dpx;\n"
-               "\t--gutter-size: %dpx;\n",
-            css_options->pixelScale,
-            css_options->gutterSize);
-    fprintf(f, "\t--shadow-mult: calc(var(--gutter-size) + var(--pixel-size));\n");
+    fmt::format_to(out,
+                   ":root {{\n"
+                   "\t--blur: 0px;\n"
+                   "\t--spread: 0px;\n"
+                   "\t--pixel-size: {}px;\n"
+                   "\t--gutter-size: {}px;\n",
+                   css_options->pixelScale,
+                   css_options->gutterSize);
+    buf += "\t--shadow-mult: calc(var(--gutter-size) + var(--pixel-size));\n";
     if (image->pixelFormat() == IMAGE_INDEXED) {
       for (y = 0; y < 256; y++) {
         fop->sequenceGetColor(y, &r, &g, &b);
         fop->sequenceGetAlpha(y, &a);
-        fprintf(f, "\t--color-%d: ", y);
+        fmt::format_to(out, "\t--color-{}: ", y);
         print_color(r, g, b, a);
-        fprintf(f, ";\n");
+        buf += ";\n";
       }
     }
-    fprintf(f, "}\n\n");
+    buf += "}\n\n";
   }
 
-  fprintf(f, ".pixel-art {\n");
-  fprintf(f, "\tposition: relative;\n");
-  fprintf(f, "\ttop: 0;\n");
-  fprintf(f, "\tleft: 0;\n");
+  buf += ".pixel-art {\n";
+  buf += "\tposition: relative;\n";
+  buf += "\ttop: 0;\n";
+  buf += "\tleft: 0;\n";
   if (css_options->withVars) {
-    fprintf(f, "\theight: var(--pixel-size);\n");
-    fprintf(f, "\twidth: var(--pixel-size);\n");
+    buf += "\theight: var(--pixel-size);\n";
+    buf += "\twidth: var(--pixel-size);\n";
   }
   else {
-    fprintf(f, "\theight: %dpx;\n", css_options->pixelScale);
-    fprintf(f, "\twidth: %dpx;\n", css_options->pixelScale);
+    fmt::format_to(out, "\theight: {}px;\n", css_options->pixelScale);
+    fmt::format_to(out, "\twidth: {}px;\n", css_options->pixelScale);
   }
-  fprintf(f, "\tbox-shadow:\n");
+  buf += "\tbox-shadow:\n";
   int num_printed_pixels = 0;
   switch (image->pixelFormat()) {
     case IMAGE_RGB: {
@@ -168,7 +190,7 @@ bool CssFormat::onSave(FileOp* fop)
             num_printed_pixels ++;
           }
         }
-        fop->setProgress((float)y / (float)(image->height()));
+        end_row();
       }
       break;
     }
@@ -183,7 +205,7 @@ bool CssFormat::onSave(FileOp* fop)
             num_printed_pixels ++;
           }
         }
-        fop->setProgress((float)y / (float)(image->height()));
+        end_row();
       }
       break;
     }
@@ -220,12 +242,13 @@ bool CssFormat::onSave(FileOp* fop)
             num_printed_pixels ++;
           }
         }
-        fop->setProgress((float)y / (float)(image->height()));
+        end_row();
       }
       break;
     }
   }
-  fprintf(f, ";\n}\n");
+  buf += ";\n}\n";
+  flush();
   if (ferror(f)) {
     fop->setError("Error writing file.\n");
     return false;
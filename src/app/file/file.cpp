@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -55,6 +55,10 @@ namespace app {
 
 using namespace base;
 
+// Milliseconds to wait each time the loading thread tries to lock a
+// progressively loaded document to decode the next frame.
+static const int kProgressiveLockTimeout = 100;
+
 class FileOp::FileAbstractImageImpl : public FileAbstractImage {
 public:
   FileAbstractImageImpl(FileOp* fop)
@@ -544,10 +548,11 @@ FileOp* FileOp::createSaveDocumentOperation(const Context* context,
                                             const FileOpROI& roi,
                                             const std::string& filename,
                                             const std::string& filenameFormatArg,
-                                            const bool ignoreEmptyFrames)
+                                            const bool ignoreEmptyFrames,
+                                            const FileOpConfig* config)
 {
   std::unique_ptr<FileOp> fop(
-    new FileOp(FileOpSave, const_cast<Context*>(context), nullptr));
+    new FileOp(FileOpSave, const_cast<Context*>(context), config));
 
   // Document to save
   fop->m_document = const_cast<Doc*>(roi.document());
@@ -1146,6 +1151,78 @@ void FileOp::createDocument(Sprite* spr)
   m_document = new Doc(spr);
 }
 
+void FileOp::publishDocument()
+{
+  ASSERT(m_progressive);
+  ASSERT(m_document);
+  ASSERT(!m_published);
+
+  // The filename is needed before the document is added to the
+  // context to load its preferences from the .ini file (postLoad()
+  // will set it again anyway)
+  m_document->setFilename(m_filename);
+
+  // Nobody knows about this document yet, so it cannot fail
+  m_readLock = m_document->readLock(0);
+  ASSERT(m_readLock != Doc::LockResult::Fail);
+
+  m_loadedFrames = 1;
+  m_published = true;
+}
+
+void FileOp::beginFrame(frame_t frame)
+{
+  ASSERT(m_published);
+  ASSERT(!m_frameLocked);
+
+  // Wait until other threads (e.g. the UI thread painting the editor)
+  // stop reading the document.
+  do {
+    m_writeLock = m_document->upgradeToWrite(kProgressiveLockTimeout);
+  } while (m_writeLock == Doc::LockResult::Fail);
+
+  m_frameLocked = true;
+}
+
+void FileOp::endFrame(frame_t frame)
+{
+  ASSERT(m_published);
+  ASSERT(m_frameLocked);
+
+  m_document->downgradeToRead(m_writeLock);
+  m_frameLocked = false;
+  m_loadedFrames = frame+1;
+}
+
+void FileOp::finishProgressiveLoad()
+{
+  if (!m_published || m_readLock == Doc::LockResult::Fail)
+    return;
+
+  // If the load was stopped (or failed) before the last frame, the
+  // document cannot be saved over the original file (it would lose
+  // the frames that weren't loaded)
+  if (m_loadedFrames < m_document->sprite()->totalFrames()) {
+    if (!m_frameLocked) {
+      do {
+        m_writeLock = m_document->upgradeToWrite(kProgressiveLockTimeout);
+      } while (m_writeLock == Doc::LockResult::Fail);
+      m_frameLocked = true;
+    }
+    m_document->impossibleToBackToSavedState();
+    m_document->markAsReadOnly();
+  }
+
+  // In case that the decoder threw an exception in the middle of a frame
+  if (m_frameLocked) {
+    m_document->downgradeToRead(m_writeLock);
+    m_frameLocked = false;
+  }
+
+  m_document->unlock(m_readLock);
+  m_readLock = Doc::LockResult::Fail;
+}
+
 void FileOp::postLoad()
 {
   if (m_document == NULL)
@@ -1187,6 +1264,87 @@ void FileOp::postLoad()
 
   // What to do with the sprite color profile?
   gfx::ColorSpaceRef spriteCS = sprite->colorSpace();
+  const app::gen::ColorProfileBehavior behavior =
+    (m_colorProfileBehavior ? *m_colorProfileBehavior:
+                              askColorProfileBehavior());
+
+  switch (behavior) {
+
+    case app::gen::ColorProfileBehavior::DISABLE:
+      sprite->setColorSpace(gfx::ColorSpace::MakeNone());
+      m_document->notifyColorSpaceChanged();
+      break;
+
+    case app::gen::ColorProfileBehavior::EMBEDDED:
+      // Do nothing, just keep the current sprite's color sprite
+      break;
+
+    case app::gen::ColorProfileBehavior::CONVERT: {
+      // Convert to the working color profile
+      auto gfxCS = m_config.workingCS;
+      if (!gfxCS->nearlyEqual(*spriteCS))
+        cmd::convert_color_profile(sprite, gfxCS);
+      break;
+    }
+
+    case app::gen::ColorProfileBehavior::ASSIGN: {
+      // Convert to the working color profile
+      auto gfxCS = m_config.workingCS;
+      sprite->setColorSpace(gfxCS);
+      m_document->notifyColorSpaceChanged();
+      break;
+    }
+  }
+
+  // Mark this document as associated to a file in the disk (so File >
+  // Save doesn't ask for a new name)
+  m_document->markAsSaved();
+
+  // In case that the document was loaded without all the information
+  // from the file, i.e. we loaded an .aseprite file created with a
+  // newer Aseprite version and cannot interpret all its information,
+  // saving this file should show a warning that some original data
+  // will be lost if we save/overwrite it.
+  if (hasIncompatibilityError()) {
+    // Mark the active undo state as impossible to reach the original
+    // disk state.
+    m_document->impossibleToBackToSavedState();
+
+    // Published documents show the warning after unlocking them
+    if (!m_published)
+      showPostLoadWarnings();
+
+    // Mark as read-only so we cannot save the file directly (without
+    // an incompatibility warning/error).
+    m_document->markAsReadOnly();
+  }
+}
+
+void FileOp::askPostLoad()
+{
+  ASSERT(m_document);
+  m_colorProfileBehavior = askColorProfileBehavior();
+}
+
+void FileOp::showPostLoadWarnings()
+{
+  if (!hasIncompatibilityError())
+    return;
+
+#ifdef ENABLE_UI
+  if (m_context && m_context->isUIAvailable()) {
+    IncompatFileWindow window;
+    window.show(m_incompatibilityError);
+  }
+  else
+#endif // ENABLE_UI
+  {
+    setError(m_incompatibilityError.c_str());
+  }
+}
+
+app::gen::ColorProfileBehavior FileOp::askColorProfileBehavior()
+{
   app::gen::ColorProfileBehavior behavior =
     app::gen::ColorProfileBehavior::DISABLE;
 
@@ -1244,63 +1402,7 @@ void FileOp::postLoad()
     }
   }
 
-  switch (behavior) {
-
-    case app::gen::ColorProfileBehavior::DISABLE:
-      sprite->setColorSpace(gfx::ColorSpace::MakeNone());
-      m_document->notifyColorSpaceChanged();
-      break;
-
-    case app::gen::ColorProfileBehavior::EMBEDDED:
-      // Do nothing, just keep the current sprite's color sprite
-      break;
-
-    case app::gen::ColorProfileBehavior::CONVERT: {
-      // Convert to the working color profile
-      auto gfxCS = m_config.workingCS;
-      if (!gfxCS->nearlyEqual(*spriteCS))
-        cmd::convert_color_profile(sprite, gfxCS);
-      break;
-    }
-
-    case app::gen::ColorProfileBehavior::ASSIGN: {
-      // Convert to the working color profile
-      auto gfxCS = m_config.workingCS;
-      sprite->setColorSpace(gfxCS);
-      m_document->notifyColorSpaceChanged();
-      break;
-    }
-  }
-
-  // Mark this document as associated to a file in the disk (so File >
-  // Save doesn't ask for a new name)
-  m_document->markAsSaved();
-
-  // In case that the document was loaded without all the information
-  // from the file, i.e. we loaded an .aseprite file created with a
-  // newer Aseprite version and cannot interpret all its information,
-  // saving this file should show a warning that some original data
-  // will be lost if we save/overwrite it.
-  if (hasIncompatibilityError()) {
-    // Mark the active undo state as impossible to reach the original
-    // disk state.
-    m_document->impossibleToBackToSavedState();
-
-#ifdef ENABLE_UI
-    if (m_context && m_context->isUIAvailable()) {
-      IncompatFileWindow window;
-      window.show(m_incompatibilityError);
-    }
-    else
-#endif // ENABLE_UI
-    {
-      setError(m_incompatibilityError.c_str());
-    }
-
-    // Mark as read-only so we cannot save the file directly (without
-    // an incompatibility warning/error).
-    m_document->markAsReadOnly();
-  }
+  return behavior;
 }
 
 void FileOp::setLoadedFormatOptions(const FormatOptionsPtr& opts)
@@ -1465,17 +1567,20 @@ void FileOp::setIncompatibilityError(const std::string& msg)
 
 void FileOp::setProgress(double progress)
 {
-  const std::lock_guard lock(m_mutex);
+  {
+    const std::lock_guard lock(m_mutex);
 
-  if (isSequence()) {
-    m_progress =
-      m_seq.progress_offset +
-      m_seq.progress_fraction*progress;
-  }
-  else {
-    m_progress = progress;
+    if (isSequence()) {
+      m_progress =
+        m_seq.progress_offset +
+        m_seq.progress_fraction*progress;
+    }
+    else {
+      m_progress = progress;
+    }
   }
 
+  // Without the lock, so the progress interface can call stop()
   if (m_progressInterface)
     m_progressInterface->ackFileOpProgress(progress);
 }
@@ -1538,6 +1643,12 @@ FileOp::FileOp(FileOpType type,
   , m_ignoreEmpty(false)
   , m_embeddedColorProfile(false)
   , m_embeddedGridBounds(false)
+  , m_progressive(false)
+  , m_published(false)
+  , m_loadedFrames(0)
+  , m_readLock(Doc::LockResult::Fail)
+  , m_writeLock(Doc::LockResult::Fail)
+  , m_frameLocked(false)
 {
   if (config)
     m_config = *config;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,9 +21,11 @@
 #include "doc/frames_sequence.h"
 #include "os/color_space.h"
 
+#include <atomic>
 #include <cstdio>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 
 // Flags for FileOp::createLoadDocumentOperation()
@@ -161,7 +163,8 @@ namespace app {
                                                const FileOpROI& roi,
                                                const std::string& filename,
                                                const std::string& filenameFormat,
-                                               const bool ignoreEmptyFrames);
+                                               const bool ignoreEmptyFrames,
+                                               const FileOpConfig* config = nullptr);
 
     static bool checkIfFormatSupportResizeOnTheFly(const std::string& filename);
 
@@ -196,6 +199,35 @@ namespace app {
     // Does extra post-load processing which may require user intervention.
     void postLoad();
 
+    // Documents that are already in the context (published
+    // progressively) must be locked for writing to call postLoad(), so
+    // they cannot ask anything to the user in that moment. In this case
+    // askPostLoad() asks the user what to do (without modifying the
+    // document) before postLoad(), and showPostLoadWarnings() shows
+    // the incompatibility warnings (if any) after it.
+    void askPostLoad();
+    void showPostLoadWarnings();
+
+    // Progressive loading (for formats that support it, e.g. .aseprite
+    // files): the document is published as soon as its first frame is
+    // loaded, so the UI thread can display it (see
+    // isDocumentPublished()) while the rest of frames are loaded. From
+    // that moment the loading thread keeps a read lock on the document
+    // (so nobody can modify it) and each following frame is loaded with
+    // the document locked for writing (beginFrame()/endFrame()). The
+    // read lock is released with finishProgressiveLoad(). If the load
+    // is stopped after the document was published, the document is
+    // not deleted (as it's already in the context), but it's marked as
+    // read-only so it cannot be saved over the original file.
+    void setProgressive(bool state) { m_progressive = state; }
+    bool isProgressive() const { return m_progressive; }
+    bool isDocumentPublished() const { return m_published; }
+    frame_t loadedFrames() const { return m_loadedFrames; }
+    void publishDocument();
+    void beginFrame(frame_t frame);
+    void endFrame(frame_t frame);
+    void finishProgressiveLoad();
+
     // Special options specific to the file format.
     FormatOptionsPtr formatOptions() const {
       return m_formatOptions;
@@ -291,6 +323,8 @@ namespace app {
            Context* context,
            const FileOpConfig* config);
 
+    app::gen::ColorProfileBehavior askColorProfileBehavior();
+
     FileOpType m_type;          // Operation type: 0=load, 1=save.
     FileFormat* m_format;
     Context* m_context;
@@ -321,6 +355,18 @@ namespace app {
     // True if the file contained a the grid bounds inside.
     bool m_embeddedGridBounds;
 
+    // What to do with the color profile (if it was already asked with
+    // askPostLoad()).
+    std::optional<app::gen::ColorProfileBehavior> m_colorProfileBehavior;
+
+    // Progressive loading.
+    bool m_progressive;
+    std::atomic<bool> m_published;
+    std::atomic<frame_t> m_loadedFrames;
+    Doc::LockResult m_readLock;
+    Doc::LockResult m_writeLock;
+    bool m_frameLocked;
+
     FileOpConfig m_config;
 
     // Options
@@ -0,0 +1,129 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "app/file/pixel_rows.h"
+#include "base/fs.h"
+#include "doc/doc.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace app;
+using namespace doc;
+
+static const char* kExtensions[] = { "bmp", "tga", "pcx", "qoi" };
+
+// Saves a full sprite in each format (file header + conversion +
+// compression + I/O).
+void BM_SaveFormat(benchmark::State& state) {
+  const char* ext = kExtensions[state.range(0)];
+  const auto colorMode = (ColorMode)state.range(1);
+  const int w = state.range(2);
+  const int h = state.range(3);
+  const std::string fn = std::string("bm_save_format.") + ext;
+
+  Context ctx;
+  std::unique_ptr<Doc> doc(ctx.documents().add(w, h, colorMode, 256));
+  doc->setFilename(fn);
+
+  Image* image = doc->sprite()->root()->firstLayer()->cel(0)->image();
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      put_pixel(image, x, y,
+                (colorMode == ColorMode::RGB ? rgba(x, y, x^y, 255): (x^y) & 255));
+
+  for (auto _ : state)
+    save_document(&ctx, doc.get());
+
+  state.SetBytesProcessed(state.iterations() * image->rowBytes() * h);
+  doc->close();
+  base::delete_file(fn);
+}
+
+// Compares writing RGBA pixels as BGRA bytes one channel at a time
+// with fputc() (the old way) vs. converting a whole row and writing
+// it with one fwrite().
+void BM_WriteBgraPerPixel(benchmark::State& state) {
+  const int w = state.range(0);
+  const int h = state.range(1);
+  std::vector<uint32_t> pixels(w*h, rgba(1, 2, 3, 4));
+
+  for (auto _ : state) {
+    FILE* f = std::tmpfile();
+    for (int y=0; y<h; ++y) {
+      const uint32_t* scanline = &pixels[y*w];
+      for (int x=0; x<w; ++x) {
+        const uint32_t c = scanline[x];
+        fputc(rgba_getb(c), f);
+        fputc(rgba_getg(c), f);
+        fputc(rgba_getr(c), f);
+        fputc(rgba_geta(c), f);
+      }
+    }
+    fclose(f);
+  }
+  state.SetBytesProcessed(state.iterations() * w * h * 4);
+}
+
+void BM_WriteBgraRows(benchmark::State& state) {
+  const int w = state.range(0);
+  const int h = state.range(1);
+  std::vector<uint32_t> pixels(w*h, rgba(1, 2, 3, 4));
+  std::vector<uint8_t> row(w*4);
+
+  for (auto _ : state) {
+    FILE* f = std::tmpfile();
+    for (int y=0; y<h; ++y) {
+      rgba_row_to_bgra(&pixels[y*w], row.data(), w);
+      fwrite(row.data(), 1, row.size(), f);
+    }
+    fclose(f);
+  }
+  state.SetBytesProcessed(state.iterations() * w * h * 4);
+}
+
+#define SAVE_ARGS(ext)                                                  \
+  ->Args({ ext, int(ColorMode::RGB), 256, 256 })                        \
+  ->Args({ ext, int(ColorMode::RGB), 2048, 2048 })                      \
+  ->Args({ ext, int(ColorMode::INDEXED), 256, 256 })                    \
+  ->Args({ ext, int(ColorMode::INDEXED), 2048, 2048 })
+
+BENCHMARK(BM_SaveFormat)
+  SAVE_ARGS(0)                  // bmp
+  SAVE_ARGS(1)                  // tga
+  SAVE_ARGS(2)                  // pcx
+  ->Args({ 3, int(ColorMode::RGB), 256, 256 }) // qoi
+  ->Args({ 3, int(ColorMode::RGB), 2048, 2048 })
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+BENCHMARK(BM_WriteBgraPerPixel)
+  ->Args({ 256, 256 })
+  ->Args({ 2048, 2048 })
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+BENCHMARK(BM_WriteBgraRows)
+  ->Args({ 256, 256 })
+  ->Args({ 2048, 2048 })
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+int app_main(int argc, char* argv[])
+{
+  ::benchmark::Initialize(&argc, argv);
+  return ::benchmark::RunSpecifiedBenchmarks();
+}
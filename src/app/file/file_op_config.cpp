@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -26,6 +26,9 @@ void FileOpConfig::fillFromPreferences()
   workingCS = get_working_rgb_space_from_preferences();
   rgbMapAlgorithm = pref.quantization.rgbmapAlgorithm();
   cacheCompressedTilesets = pref.tileset.cacheCompressedTilesets();
+  cacheCompressedCels = pref.experimental.cacheCompressedCels();
+  dedupCelImages = pref.experimental.dedupCelImages();
+  dedupTileUserData = pref.experimental.dedupTileUserData();
 }
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -42,6 +42,30 @@ namespace app {
     // compressed data that was loaded as-is).
     bool cacheCompressedTilesets = true;
 
+    // Cache the compressed pixels of each cel image when we save a
+    // .aseprite file, so saving the file again only needs to
+    // re-compress the images that were modified. The cached data is
+    // kept in memory with each image (see doc::Image::getMemSize()).
+    bool cacheCompressedCels = false;
+
+    // Save cels with identical pixels (but not linked) as references
+    // to the first saved image (ASE_FILE_IMAGE_REF_CEL) in .aseprite
+    // files. Older versions of the program cannot read these cels.
+    bool dedupCelImages = false;
+
+    // When we load a cel that references the image of other cel, the
+    // doc::Image is shared between both cels instead of copied. This
+    // is not a preference: it's only for read-only loaders (e.g.
+    // thumbnails), as modifying one cel would modify the other one.
+    bool shareReferencedImages = false;
+
+    // Save tiles with the same user data (text, color, and
+    // properties) as a reference to the first tile with that user
+    // data (ASE_USER_DATA_FLAG_SAME_AS_TILE) in .aseprite files.
+    // Older versions of the program load these tiles without user
+    // data.
+    bool dedupTileUserData = false;
+
     void fillFromPreferences();
   };
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -10,9 +10,11 @@
 #include "app/app.h"
 #include "app/context.h"
 #include "app/doc.h"
+#include "app/doc_access.h"
 #include "app/file/file.h"
 #include "app/file/file_formats_manager.h"
 #include "base/base64.h"
+#include "base/fs.h"
 #include "doc/doc.h"
 #include "doc/user_data.h"
 #include "fmt/format.h"
@@ -341,3 +343,437 @@ TEST(File, CustomProperties)
     }
   }
 }
+
+TEST(File, SimpleFormatsRoundTrip)
+{
+  app::Context ctx;
+
+  struct TestCase {
+    std::string filename;
+    doc::ColorMode mode;
+  };
+  std::vector<TestCase> tests = {
+    { "test_rows.bmp", doc::ColorMode::RGB },
+    { "test_rows.bmp", doc::ColorMode::INDEXED },
+    { "test_rows.tga", doc::ColorMode::RGB },
+    { "test_rows.tga", doc::ColorMode::INDEXED },
+    { "test_rows.pcx", doc::ColorMode::RGB },
+    { "test_rows.pcx", doc::ColorMode::INDEXED },
+    { "test_rows.qoi", doc::ColorMode::RGB },
+  };
+
+  // Odd widths to test row padding/packing
+  for (const TestCase& test : tests) {
+    for (int w : { 1, 3, 17, 130 }) {
+      const int h = 5;
+      auto pixelColor = [&test](int x, int y) -> color_t {
+        if (test.mode == doc::ColorMode::RGB)
+          return rgba((x*7) & 255, (y*31) & 255, (x*y) & 255, 255);
+        else
+          return 1 + ((x+y*3) % 200);
+      };
+
+      {
+        std::unique_ptr<Doc> doc(
+          ctx.documents().add(w, h, test.mode, 256));
+        doc->setFilename(test.filename);
+
+        Image* image = doc->sprite()->root()->firstLayer()->cel(0)->image();
+        for (int y=0; y<h; y++)
+          for (int x=0; x<w; x++)
+            put_pixel(image, x, y, pixelColor(x, y));
+
+        save_document(&ctx, doc.get());
+        doc->close();
+      }
+
+      {
+        std::unique_ptr<Doc> doc(load_document(&ctx, test.filename));
+        ASSERT_TRUE(doc != nullptr) << test.filename;
+        ASSERT_EQ(w, doc->sprite()->width());
+        ASSERT_EQ(h, doc->sprite()->height());
+        ASSERT_EQ(test.mode, doc->sprite()->colorMode());
+
+        const Image* image = doc->sprite()->root()->firstLayer()->cel(0)->image();
+        for (int y=0; y<h; y++)
+          for (int x=0; x<w; x++)
+            ASSERT_EQ(pixelColor(x, y), get_pixel(image, x, y))
+              << test.filename << " " << w << "x" << h << " (" << x << ", " << y << ")";
+
+        doc->close();
+      }
+    }
+  }
+}
+
+TEST(File, DedupTileUserData)
+{
+  app::Context ctx;
+  const int ntiles = 64;
+
+  auto save = [&ctx, ntiles](const std::string& fn, const bool dedup) {
+    std::unique_ptr<Doc> doc(
+      ctx.documents().add(32, 32, doc::ColorMode::RGB, 256));
+    doc->setFilename(fn);
+
+    Sprite* sprite = doc->sprite();
+    auto tileset = new Tileset(sprite, Grid::MakeRect(gfx::Size(4, 4)), ntiles);
+    sprite->tilesets()->add(tileset);
+
+    for (tile_index ti=1; ti<ntiles; ++ti) {
+      UserData data;
+      data.properties()["collision"] = std::string(ti == 5 ? "none": "solid");
+      data.properties("ext")["material"] = std::string("stone");
+      data.properties("ext")["friction"] = int32_t(3);
+      tileset->setTileData(ti, data);
+    }
+
+    FileOpConfig config;
+    config.dedupTileUserData = dedup;
+
+    std::unique_ptr<FileOp> fop(
+      FileOp::createSaveDocumentOperation(
+        &ctx,
+        FileOpROI(doc.get(), sprite->bounds(),
+                  "", "", FramesSequence(), false),
+        fn, "", false, &config));
+    ASSERT_TRUE(fop != nullptr);
+    fop->operate();
+    fop->done();
+    ASSERT_FALSE(fop->hasError());
+    doc->close();
+  };
+
+  save("test_tiles.ase", false);
+  save("test_tiles_dedup.ase", true);
+
+  // Duplicated user data is saved only once
+  EXPECT_LT(base::file_size("test_tiles_dedup.ase"),
+            base::file_size("test_tiles.ase"));
+
+  for (const char* fn : { "test_tiles.ase", "test_tiles_dedup.ase" }) {
+    std::unique_ptr<Doc> doc(load_document(&ctx, fn));
+    ASSERT_TRUE(doc != nullptr);
+    ASSERT_TRUE(doc->sprite()->hasTilesets());
+
+    const Tileset* tileset = doc->sprite()->tilesets()->get(0);
+    ASSERT_TRUE(tileset != nullptr);
+    ASSERT_EQ(ntiles, tileset->size());
+
+    EXPECT_TRUE(tileset->getTileData(0).isEmpty());
+    for (tile_index ti=1; ti<ntiles; ++ti) {
+      const UserData& data = tileset->getTileData(ti);
+      EXPECT_EQ((ti == 5 ? "none": "solid"),
+                doc::get_value<std::string>(data.properties().at("collision")));
+      EXPECT_EQ("stone",
+                doc::get_value<std::string>(data.properties("ext").at("material")));
+      EXPECT_EQ(3, doc::get_value<int32_t>(data.properties("ext").at("friction")));
+    }
+
+    // Identical properties are shared in memory
+    EXPECT_EQ(tileset->getTileData(1).propertiesMapsRef(),
+              tileset->getTileData(ntiles-1).propertiesMapsRef());
+    EXPECT_NE(tileset->getTileData(1).propertiesMapsRef(),
+              tileset->getTileData(5).propertiesMapsRef());
+
+    doc->close();
+  }
+}
+
+TEST(File, CacheCompressedCels)
+{
+  app::Context ctx;
+  std::unique_ptr<Doc> doc(
+    ctx.documents().add(64, 64, doc::ColorMode::RGB, 256));
+  doc->setFilename("test_cels.ase");
+
+  Image* image = doc->sprite()->root()->firstLayer()->cel(0)->image();
+  for (int y=0; y<image->height(); ++y)
+    for (int x=0; x<image->width(); ++x)
+      image->putPixel(x, y, rgba(x, y, x^y, 255));
+
+  // The cache is disabled by default
+  ASSERT_EQ(0, save_document(&ctx, doc.get()));
+  EXPECT_TRUE(image->compressedData().empty());
+
+  auto save = [&ctx, &doc](const bool cache) {
+    FileOpConfig config;
+    config.cacheCompressedCels = cache;
+
+    std::unique_ptr<FileOp> fop(
+      FileOp::createSaveDocumentOperation(
+        &ctx,
+        FileOpROI(doc.get(), doc->sprite()->bounds(),
+                  "", "", FramesSequence(), false),
+        doc->filename(), "", false, &config));
+    ASSERT_TRUE(fop != nullptr);
+    fop->operate();
+    fop->done();
+    ASSERT_FALSE(fop->hasError());
+  };
+
+  auto check = [&ctx, image]() {
+    std::unique_ptr<Doc> loaded(load_document(&ctx, "test_cels.ase"));
+    ASSERT_TRUE(loaded != nullptr);
+    const Image* loadedImage =
+      loaded->sprite()->root()->firstLayer()->cel(0)->image();
+    EXPECT_EQ(0, count_diff_between_images(image, loadedImage));
+    loaded->close();
+  };
+
+  const int memSize = image->getMemSize();
+  save(true);
+  EXPECT_FALSE(image->compressedData().empty());
+  EXPECT_EQ(image->version(), image->compressedDataVersion());
+  EXPECT_EQ(memSize + int(image->compressedData().size()), image->getMemSize());
+  check();
+
+  // Save again with the cached data
+  save(true);
+  check();
+
+  // Modify pixels without changing the image version (the hash
+  // discards the cached data)
+  image->putPixel(3, 4, rgba(255, 0, 0, 255));
+  save(true);
+  check();
+
+  // Saving without the cache discards the cached data
+  save(false);
+  EXPECT_TRUE(image->compressedData().empty());
+  EXPECT_EQ(memSize, image->getMemSize());
+  check();
+
+  doc->close();
+}
+
+TEST(File, DedupCelImages)
+{
+  app::Context ctx;
+
+  auto save = [&ctx](const std::string& fn, const bool dedup) {
+    std::unique_ptr<Doc> doc(
+      ctx.documents().add(32, 32, doc::ColorMode::RGB, 256));
+    doc->setFilename(fn);
+
+    Sprite* sprite = doc->sprite();
+    Image* image = sprite->root()->firstLayer()->cel(0)->image();
+    for (int y=0; y<image->height(); ++y)
+      for (int x=0; x<image->width(); ++x)
+        image->putPixel(x, y, rgba(x*8, y*8, x^y, 255));
+
+    // Cel with the same pixels (but not linked) in other layer, with
+    // its own position and opacity
+    auto layer2 = new LayerImage(sprite);
+    sprite->root()->addLayer(layer2);
+    Cel* cel2 = new Cel(0, ImageRef(Image::createCopy(image)));
+    cel2->setPosition(5, 3);
+    cel2->setOpacity(128);
+    layer2->addCel(cel2);
+
+    // Cel with different pixels
+    auto layer3 = new LayerImage(sprite);
+    sprite->root()->addLayer(layer3);
+    ImageRef image3(Image::createCopy(image));
+    image3->putPixel(0, 0, rgba(255, 0, 0, 255));
+    layer3->addCel(new Cel(0, image3));
+
+    FileOpConfig config;
+    config.dedupCelImages = dedup;
+
+    std::unique_ptr<FileOp> fop(
+      FileOp::createSaveDocumentOperation(
+        &ctx,
+        FileOpROI(doc.get(), sprite->bounds(),
+                  "", "", FramesSequence(), false),
+        fn, "", false, &config));
+    ASSERT_TRUE(fop != nullptr);
+    fop->operate();
+    fop->done();
+    ASSERT_FALSE(fop->hasError());
+    doc->close();
+  };
+
+  auto load = [&ctx](const std::string& fn, const bool share) -> Doc* {
+    FileOpConfig config;
+    config.shareReferencedImages = share;
+
+    std::unique_ptr<FileOp> fop(
+      FileOp::createLoadDocumentOperation(
+        &ctx, fn, FILE_LOAD_SEQUENCE_NONE, &config));
+    if (!fop)
+      return nullptr;
+    fop->operate();
+    fop->done();
+    fop->postLoad();
+    EXPECT_FALSE(fop->hasError());
+    return fop->releaseDocument();
+  };
+
+  save("test_dedup_cels.ase", false);
+  save("test_dedup_cels_ref.ase", true);
+
+  // The duplicated image is compressed and saved only once
+  EXPECT_LT(base::file_size("test_dedup_cels_ref.ase"),
+            base::file_size("test_dedup_cels.ase"));
+
+  for (const char* fn : { "test_dedup_cels.ase", "test_dedup_cels_ref.ase" }) {
+    for (const bool share : { false, true }) {
+      std::unique_ptr<Doc> doc(load(fn, share));
+      ASSERT_TRUE(doc != nullptr);
+
+      const LayerList layers = doc->sprite()->allLayers();
+      ASSERT_EQ(3, layers.size());
+      const Cel* cel1 = layers[0]->cel(0);
+      const Cel* cel2 = layers[1]->cel(0);
+      const Cel* cel3 = layers[2]->cel(0);
+      ASSERT_TRUE(cel1 && cel2 && cel3);
+
+      EXPECT_EQ(gfx::Point(5, 3), cel2->position());
+      EXPECT_EQ(128, cel2->opacity());
+      EXPECT_EQ(0, cel2->links());
+      EXPECT_EQ(0, count_diff_between_images(cel1->image(), cel2->image()));
+      EXPECT_EQ(1, count_diff_between_images(cel1->image(), cel3->image()));
+
+      // Images are shared only when the file contains image
+      // references and the loader asks for them
+      const bool shared = (share &&
+                           std::string(fn) == "test_dedup_cels_ref.ase");
+      EXPECT_EQ(shared, cel1->image() == cel2->image()) << fn;
+      EXPECT_NE(cel1->image(), cel3->image());
+
+      doc->close();
+    }
+  }
+}
+
+TEST(File, ProgressiveLoad)
+{
+  app::Context ctx;
+  const frame_t nframes = 4;
+  {
+    std::unique_ptr<Doc> doc(
+      ctx.documents().add(16, 16, doc::ColorMode::RGB, 256));
+    doc->setFilename("test_progressive.ase");
+
+    Sprite* sprite = doc->sprite();
+    LayerImage* layer = static_cast<LayerImage*>(sprite->root()->firstLayer());
+    sprite->setTotalFrames(nframes);
+    for (frame_t frame=0; frame<nframes; ++frame) {
+      if (frame > 0)
+        layer->addCel(new Cel(frame, ImageRef(Image::create(IMAGE_RGB, 16, 16))));
+      clear_image(layer->cel(frame)->image(), rgba(frame*50, 0, 0, 255));
+    }
+    ASSERT_EQ(0, save_document(&ctx, doc.get()));
+    doc->close();
+  }
+
+  // Checks the document each time the loading thread reports progress
+  struct Progress : public IFileOpProgress {
+    FileOp* fop = nullptr;
+    bool published = false;
+    std::string filename;
+    void ackFileOpProgress(double) override {
+      if (!published && fop->isDocumentPublished()) {
+        published = true;
+        filename = fop->document()->filename();
+        EXPECT_EQ(1, fop->loadedFrames());
+      }
+    }
+  } progress;
+
+  std::unique_ptr<FileOp> fop(
+    FileOp::createLoadDocumentOperation(
+      &ctx, "test_progressive.ase", FILE_LOAD_SEQUENCE_NONE));
+  ASSERT_TRUE(fop != nullptr);
+  fop->setProgressive(true);
+  progress.fop = fop.get();
+  fop->operate(&progress);
+  fop->finishProgressiveLoad();
+  fop->done();
+  ASSERT_FALSE(fop->hasError());
+
+  // The document is published with its filename (so the UI can load
+  // its preferences) before the rest of frames are loaded
+  EXPECT_TRUE(progress.published);
+  EXPECT_EQ("test_progressive.ase", progress.filename);
+  EXPECT_EQ(nframes, fop->loadedFrames());
+
+  // The loading thread doesn't keep the document locked
+  Doc* doc = fop->document();
+  ASSERT_TRUE(doc != nullptr);
+  const Doc::LockResult lockResult = doc->writeLock(0);
+  ASSERT_NE(Doc::LockResult::Fail, lockResult);
+
+  // postLoad() with the document locked for writing
+  fop->askPostLoad();
+  fop->postLoad();
+  fop->showPostLoadWarnings();
+  doc->unlock(lockResult);
+  EXPECT_FALSE(fop->hasError());
+  EXPECT_FALSE(doc->isModified());
+
+  std::unique_ptr<Doc> loaded(fop->releaseDocument());
+  Sprite* sprite = loaded->sprite();
+  ASSERT_EQ(nframes, sprite->totalFrames());
+  for (frame_t frame=0; frame<nframes; ++frame) {
+    const Cel* cel = sprite->root()->firstLayer()->cel(frame);
+    ASSERT_TRUE(cel != nullptr);
+    EXPECT_EQ(rgba(frame*50, 0, 0, 255), get_pixel(cel->image(), 8, 8));
+  }
+  loaded->close();
+}
+
+TEST(File, StopProgressiveLoad)
+{
+  app::Context ctx;
+  const frame_t nframes = 4;
+  {
+    std::unique_ptr<Doc> doc(
+      ctx.documents().add(16, 16, doc::ColorMode::RGB, 256));
+    doc->setFilename("test_stop_progressive.ase");
+
+    Sprite* sprite = doc->sprite();
+    LayerImage* layer = static_cast<LayerImage*>(sprite->root()->firstLayer());
+    sprite->setTotalFrames(nframes);
+    for (frame_t frame=1; frame<nframes; ++frame)
+      layer->addCel(new Cel(frame, ImageRef(Image::create(IMAGE_RGB, 16, 16))));
+    ASSERT_EQ(0, save_document(&ctx, doc.get()));
+    doc->close();
+  }
+
+  // Stops the load (as when the user closes the document) as soon as
+  // the document is published
+  struct Progress : public IFileOpProgress {
+    FileOp* fop = nullptr;
+    void ackFileOpProgress(double) override {
+      if (fop->isDocumentPublished() && !fop->isStop())
+        fop->stop();
+    }
+  } progress;
+
+  std::unique_ptr<FileOp> fop(
+    FileOp::createLoadDocumentOperation(
+      &ctx, "test_stop_progressive.ase", FILE_LOAD_SEQUENCE_NONE));
+  ASSERT_TRUE(fop != nullptr);
+  fop->setProgressive(true);
+  progress.fop = fop.get();
+  fop->operate(&progress);
+  fop->finishProgressiveLoad();
+  fop->done();
+  EXPECT_LT(fop->loadedFrames(), nframes);
+
+  // The partially loaded document cannot be saved over its file
+  Doc* doc = fop->releaseDocument();
+  ASSERT_TRUE(doc != nullptr);
+  EXPECT_TRUE(doc->isReadOnly());
+
+  // The document is destroyed (not closed), so it cannot be reopened
+  doc->setContext(&ctx);
+  ASSERT_EQ(1, ctx.documents().size());
+  {
+    DocDestroyer destroyer(&ctx, doc, 0);
+    destroyer.destroyDocument();
+  }
+  EXPECT_TRUE(ctx.documents().empty());
+}
@@ -14,10 +14,14 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/file/pixel_rows.h"
 #include "base/cfile.h"
 #include "base/file_handle.h"
 #include "doc/doc.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace base;
@@ -240,35 +244,35 @@ bool PcxFormat::onSave(FileOp* fop)
   for (c=0; c<54; c++)              /* filler */
     fputc(0, f);
 
+  // Pixels of the current scanline in the file layout (one plane
+  // after the other), and the RLE encoded scanline.
+  const int w = spec.width();
+  std::vector<uint8_t> pixels(w*planes);
+  std::vector<uint8_t> encoded;
+  encoded.reserve(2*w*planes);
+
   for (y=0; y<spec.height(); y++) {           /* for each scanline... */
+    const uint8_t* scanline = img->getScanline(y);
+
+    switch (spec.colorMode()) {
+      case ColorMode::RGB:
+        rgba_row_to_rgb_planes((const uint32_t*)scanline,
+                               &pixels[0], &pixels[w], &pixels[w*2], w);
+        break;
+      case ColorMode::GRAYSCALE:
+        graya_row_to_gray((const uint16_t*)scanline, pixels.data(), w);
+        break;
+      case ColorMode::INDEXED:
+        std::copy(scanline, scanline+w, pixels.begin());
+        break;
+    }
+
     runcount = 0;
     runchar = 0;
+    encoded.clear();
 
-    const uint8_t* scanline = img->getScanline(y);
-
-    for (x=0; x<spec.width()*planes; x++) {  /* for each pixel... */
-      if (depth == 8) {
-        if (spec.colorMode() == ColorMode::INDEXED)
-          ch = scanline[x];
-        else if (spec.colorMode() == ColorMode::GRAYSCALE) {
-          c = ((const uint16_t*)scanline)[x];
-          ch = graya_getv(c);
-        }
-      }
-      else {
-        if (x < spec.width()) {
-          c = ((const uint32_t*)scanline)[x];
-          ch = rgba_getr(c);
-        }
-        else if (x<spec.width()*2) {
-          c = ((const uint32_t*)scanline)[x-spec.width()];
-          ch = rgba_getg(c);
-        }
-        else {
-          c = ((const uint32_t*)scanline)[x-spec.width()*2];
-          ch = rgba_getb(c);
-        }
-      }
+    for (x=0; x<w*planes; x++) {             /* for each pixel... */
+      ch = pixels[x];
       if (runcount == 0) {
         runcount = 1;
         runchar = ch;
@@ -276,8 +280,8 @@ bool PcxFormat::onSave(FileOp* fop)
       else {
         if ((ch != runchar) || (runcount >= 0x3f)) {
           if ((runcount > 1) || ((runchar & 0xC0) == 0xC0))
-            fputc(0xC0 | runcount, f);
-          fputc(runchar, f);
+            encoded.push_back(0xC0 | runcount);
+          encoded.push_back(runchar);
           runcount = 1;
           runchar = ch;
         }
@@ -287,9 +291,11 @@ bool PcxFormat::onSave(FileOp* fop)
     }
 
     if ((runcount > 1) || ((runchar & 0xC0) == 0xC0))
-      fputc(0xC0 | runcount, f);
+      encoded.push_back(0xC0 | runcount);
+
+    encoded.push_back(runchar);
 
-    fputc(runchar, f);
+    fwrite(encoded.data(), 1, encoded.size(), f);
 
     fop->setProgress((float)(y+1) / (float)(spec.height()));
   }
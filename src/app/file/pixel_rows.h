@@ -0,0 +1,108 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_FILE_PIXEL_ROWS_H_INCLUDED
+#define APP_FILE_PIXEL_ROWS_H_INCLUDED
+#pragma once
+
+#include "doc/color.h"
+
+#include <cstdint>
+
+// Row-level conversion kernels used by the simple file format
+// encoders (BMP, PCX, QOI, etc.) to convert a whole scanline from
+// our in-memory pixel format to the file layout in one pass. They
+// are simple loops over contiguous memory without calls in the
+// middle, so the compiler can unroll/auto-vectorize them.
+
+namespace app {
+
+  // RGBA -> BGR (e.g. 24bpp BMP)
+  inline void rgba_row_to_bgr(const uint32_t* src, uint8_t* dst, const int w) {
+    for (int x=0; x<w; ++x, dst+=3) {
+      const uint32_t c = src[x];
+      dst[0] = doc::rgba_getb(c);
+      dst[1] = doc::rgba_getg(c);
+      dst[2] = doc::rgba_getr(c);
+    }
+  }
+
+  // RGBA -> BGRA (e.g. 32bpp BMP)
+  inline void rgba_row_to_bgra(const uint32_t* src, uint8_t* dst, const int w) {
+    for (int x=0; x<w; ++x, dst+=4) {
+      const uint32_t c = src[x];
+      dst[0] = doc::rgba_getb(c);
+      dst[1] = doc::rgba_getg(c);
+      dst[2] = doc::rgba_getr(c);
+      dst[3] = doc::rgba_geta(c);
+    }
+  }
+
+  // RGBA -> R, G, B, A bytes (e.g. QOI with alpha)
+  inline void rgba_row_to_rgba(const uint32_t* src, uint8_t* dst, const int w) {
+    for (int x=0; x<w; ++x, dst+=4) {
+      const uint32_t c = src[x];
+      dst[0] = doc::rgba_getr(c);
+      dst[1] = doc::rgba_getg(c);
+      dst[2] = doc::rgba_getb(c);
+      dst[3] = doc::rgba_geta(c);
+    }
+  }
+
+  // RGBA -> RGB (e.g. QOI without alpha)
+  inline void rgba_row_to_rgb(const uint32_t* src, uint8_t* dst, const int w) {
+    for (int x=0; x<w; ++x, dst+=3) {
+      const uint32_t c = src[x];
+      dst[0] = doc::rgba_getr(c);
+      dst[1] = doc::rgba_getg(c);
+      dst[2] = doc::rgba_getb(c);
+    }
+  }
+
+  // RGBA -> R, G, B in three separated planes (e.g. 24bpp PCX)
+  inline void rgba_row_to_rgb_planes(const uint32_t* src,
+                                     uint8_t* r, uint8_t* g, uint8_t* b,
+                                     const int w) {
+    for (int x=0; x<w; ++x) {
+      const uint32_t c = src[x];
+      r[x] = doc::rgba_getr(c);
+      g[x] = doc::rgba_getg(c);
+      b[x] = doc::rgba_getb(c);
+    }
+  }
+
+  // Gray+Alpha -> Gray (discarding alpha)
+  inline void graya_row_to_gray(const uint16_t* src, uint8_t* dst, const int w) {
+    for (int x=0; x<w; ++x)
+      dst[x] = doc::graya_getv(src[x]);
+  }
+
+  // Packs 8-bit indexes in 1, 2, 4 or 8 bits per pixel (the first
+  // pixel is stored in the most significant bits of each byte).
+  // Returns the number of written bytes.
+  inline int pack_indexed_row(const uint8_t* src, uint8_t* dst,
+                              const int w, const int bpp) {
+    if (bpp == 8) {
+      for (int x=0; x<w; ++x)
+        dst[x] = src[x];
+      return w;
+    }
+
+    const int colorsPerByte = 8 / bpp;
+    const int mask = (1 << bpp) - 1;
+    int n = 0;
+    for (int x=0; x<w; ++n) {
+      uint8_t value = 0;
+      for (int k=colorsPerByte-1; k>=0 && x<w; --k, ++x)
+        value |= (src[x] & mask) << (bpp*k);
+      dst[n] = value;
+    }
+    return n;
+  }
+
+} // namespace app
+
+#endif
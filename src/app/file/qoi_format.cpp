@@ -10,6 +10,7 @@
 
 #include "app/file/file.h"
 #include "app/file/file_format.h"
+#include "app/file/pixel_rows.h"
 #include "base/file_handle.h"
 
 #define QOI_NO_STDIO
@@ -160,30 +161,14 @@ bool QoiFormat::onSave(FileOp* fop)
   if (!pixels)
     return false;
 
-  auto dst = pixels;
+  const int dstRowBytes = desc.width * desc.channels;
   for (int y=0; y<desc.height; ++y) {
-    auto src = (uint32_t*)image->getPixelAddress(0, y);
-    switch (desc.channels) {
-      case 4:
-        for (int x=0; x<desc.width; ++x, ++src) {
-          uint32_t c = *src;
-          dst[0] = doc::rgba_getr(c);
-          dst[1] = doc::rgba_getg(c);
-          dst[2] = doc::rgba_getb(c);
-          dst[3] = doc::rgba_geta(c);
-          dst += 4;
-        }
-        break;
-      case 3:
-        for (int x=0; x<desc.width; ++x, ++src) {
-          uint32_t c = *src;
-          dst[0] = doc::rgba_getr(c);
-          dst[1] = doc::rgba_getg(c);
-          dst[2] = doc::rgba_getb(c);
-          dst += 3;
-        }
-        break;
-    }
+    auto src = (const uint32_t*)image->getPixelAddress(0, y);
+    auto dst = pixels + y*dstRowBytes;
+    if (desc.channels == 4)
+      rgba_row_to_rgba(src, dst, desc.width);
+    else
+      rgba_row_to_rgb(src, dst, desc.width);
   }
 
   int size = 0;
@@ -18,9 +18,15 @@
 #include "app/pref/preferences.h"
 #include "base/cfile.h"
 #include "base/file_handle.h"
+#include "doc/algorithm/color_rects.h"
 #include "doc/doc.h"
+#include "fmt/format.h"
 #include "ui/window.h"
 
+#include <algorithm>
+#include <iterator>
+#include <string>
+
 #include "svg_options.xml.h"
 
 namespace app {
@@ -82,80 +88,86 @@ bool SvgFormat::onLoad(FileOp* fop)
 bool SvgFormat::onSave(FileOp* fop)
 {
   const ImageRef image = fop->sequenceImageToSave();
-  int x, y, c, r, g, b, a, alpha;
   const auto svg_options = std::static_pointer_cast<SvgOptions>(fop->formatOptions());
   const int pixelScaleValue = std::clamp(svg_options->pixelScale, 0, 10000);
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
   FILE* f = handle.get();
-  auto printcol = [f](int x, int y,int r, int g, int b, int a, int pxScale) {
-    fprintf(f, "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" fill=\"#%02X%02X%02X\" ",
-            x*pxScale, y*pxScale, pxScale, pxScale, r, g, b);
+
+  // Output is accumulated in this buffer and written in big blocks
+  // (instead of calling fprintf() for each pixel).
+  constexpr std::size_t kBufferSize = 64*1024;
+  std::string buf;
+  buf.reserve(kBufferSize);
+  auto flush = [f, &buf]() {
+    fwrite(buf.data(), 1, buf.size(), f);
+    buf.clear();
+  };
+  auto printrect = [&buf](const gfx::Rect& rc, int r, int g, int b, int a, int pxScale) {
+    fmt::format_to(std::back_inserter(buf),
+                   "<rect x=\"{}\" y=\"{}\" width=\"{}\" height=\"{}\" fill=\"#{:02X}{:02X}{:02X}\" ",
+                   rc.x*pxScale, rc.y*pxScale, rc.w*pxScale, rc.h*pxScale, r, g, b);
     if (a != 255)
-      fprintf(f, "opacity=\"%f\" ", (float)a / 255.0);
-    fprintf(f, "/>\n");
+      fmt::format_to(std::back_inserter(buf), "opacity=\"{:f}\" ", (float)a / 255.0);
+    buf += "/>\n";
   };
-  fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n");
-  fprintf(f, "<svg version=\"1.1\" width=\"%d\" height=\"%d\" xmlns=\"http://www.w3.org/2000/svg\" shape-rendering=\"crispEdges\">\n",
-          image->width()*pixelScaleValue, image->height()*pixelScaleValue);
-
-  switch (image->pixelFormat()) {
-
-    case IMAGE_RGB: {
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<RgbTraits>(image.get(), x, y);
-          alpha = rgba_geta(c);
-          if (alpha != 0x00)
-            printcol(x, y, rgba_getr(c), rgba_getg(c), rgba_getb(c), alpha, pixelScaleValue);
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
-      break;
+  fmt::format_to(std::back_inserter(buf),
+                 "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+                 "<svg version=\"1.1\" width=\"{}\" height=\"{}\" xmlns=\"http://www.w3.org/2000/svg\" shape-rendering=\"crispEdges\">\n",
+                 image->width()*pixelScaleValue, image->height()*pixelScaleValue);
+
+  // Same colored pixels are merged in rectangles to reduce the number
+  // of <rect> elements (the final render is the same).
+  unsigned char image_palette[256][4];
+  color_t mask_color = -1;
+  if (image->pixelFormat() == IMAGE_INDEXED) {
+    int r, g, b, a;
+    for (int i=0; i<256; ++i) {
+      fop->sequenceGetColor(i, &r, &g, &b);
+      image_palette[i][0] = r;
+      image_palette[i][1] = g;
+      image_palette[i][2] = b;
+      fop->sequenceGetAlpha(i, &a);
+      image_palette[i][3] = a;
     }
-    case IMAGE_GRAYSCALE: {
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<GrayscaleTraits>(image.get(), x, y);
-          auto v = graya_getv(c);
-          alpha = graya_geta(c);
-          if (alpha != 0x00)
-            printcol(x, y, v, v, v, alpha, pixelScaleValue);
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
-      break;
+    if (fop->document()->sprite()->backgroundLayer() == NULL ||
+        !fop->document()->sprite()->backgroundLayer()->isVisible()) {
+      mask_color = fop->document()->sprite()->transparentColor();
     }
-    case IMAGE_INDEXED: {
-      unsigned char image_palette[256][4];
-      for (y=0; y<256; y++) {
-        fop->sequenceGetColor(y, &r, &g, &b);
-        image_palette[y][0] = r;
-        image_palette[y][1] = g;
-        image_palette[y][2] = b;
-        fop->sequenceGetAlpha(y, &a);
-        image_palette[y][3] = a;
-      }
-      color_t mask_color = -1;
-      if (fop->document()->sprite()->backgroundLayer() == NULL ||
-          !fop->document()->sprite()->backgroundLayer()->isVisible()) {
-        mask_color = fop->document()->sprite()->transparentColor();
-      }
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<IndexedTraits>(image.get(), x, y);
-          if (c != mask_color)
-            printcol(x, y, image_palette[c][0] & 0xff,
-                     image_palette[c][1] & 0xff,
-                     image_palette[c][2] & 0xff,
-                     image_palette[c][3] & 0xff,
-                     pixelScaleValue);
-        }
-        fop->setProgress((float)y / (float)(image->height()));
+  }
+
+  doc::algorithm::ColorRects rects;
+  doc::algorithm::image_to_color_rects(image.get(), mask_color, rects);
+
+  for (std::size_t i=0; i<rects.size(); ++i) {
+    const auto& rc = rects[i];
+    const color_t c = rc.color;
+    switch (image->pixelFormat()) {
+      case IMAGE_RGB:
+        printrect(rc.bounds, rgba_getr(c), rgba_getg(c), rgba_getb(c),
+                  rgba_geta(c), pixelScaleValue);
+        break;
+      case IMAGE_GRAYSCALE: {
+        const int v = graya_getv(c);
+        printrect(rc.bounds, v, v, v, graya_geta(c), pixelScaleValue);
+        break;
       }
-      break;
+      case IMAGE_INDEXED:
+        printrect(rc.bounds,
+                  image_palette[c][0] & 0xff,
+                  image_palette[c][1] & 0xff,
+                  image_palette[c][2] & 0xff,
+                  image_palette[c][3] & 0xff,
+                  pixelScaleValue);
+        break;
+    }
+    if (buf.size() >= kBufferSize) {
+      flush();
+      fop->setProgress((float)rc.bounds.y / (float)(image->height()));
     }
   }
-  fprintf(f, "</svg>");
+  buf += "</svg>";
+  flush();
+
   if (ferror(f)) {
     fop->setError("Error writing file.\n");
     return false;
@@ -26,6 +26,8 @@
 
 #include "tga_options.xml.h"
 
+#include <vector>
+
 namespace app {
 
 using namespace base;
@@ -218,6 +220,57 @@ bool TgaFormat::onLoad(FileOp* fop)
 
 namespace {
 
+// The tga::Encoder writes the whole file byte by byte, so instead of
+// calling fputc() for each byte (tga::StdioFileInterface), we
+// accumulate the bytes in a big buffer that is written with fwrite().
+class BufferedFileInterface : public tga::FileInterface {
+public:
+  BufferedFileInterface(FILE* file) : m_file(file) {
+    m_buf.reserve(kBufferSize);
+  }
+
+  ~BufferedFileInterface() {
+    flush();
+  }
+
+  bool ok() const override {
+    return !ferror(m_file);
+  }
+
+  size_t tell() override {
+    return size_t(ftell(m_file)) + m_buf.size();
+  }
+
+  void seek(size_t absPos) override {
+    flush();
+    fseek(m_file, absPos, SEEK_SET);
+  }
+
+  uint8_t read8() override {
+    // This interface is used only to write files
+    ASSERT(false);
+    return 0;
+  }
+
+  void write8(uint8_t value) override {
+    m_buf.push_back(value);
+    if (m_buf.size() >= kBufferSize)
+      flush();
+  }
+
+  void flush() {
+    if (!m_buf.empty()) {
+      fwrite(m_buf.data(), 1, m_buf.size(), m_file);
+      m_buf.clear();
+    }
+  }
+
+private:
+  static constexpr size_t kBufferSize = 64*1024;
+  FILE* m_file;
+  std::vector<uint8_t> m_buf;
+};
+
 void prepare_header(tga::Header& header,
                     const doc::ImageSpec& spec,
                     const doc::Palette* palette,
@@ -293,7 +346,7 @@ bool TgaFormat::onSave(FileOp* fop)
   const Palette* palette = fop->sequenceGetPalette();
 
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
-  tga::StdioFileInterface finterface(handle.get());
+  BufferedFileInterface finterface(handle.get());
   tga::Encoder encoder(&finterface);
   tga::Header header;
 
@@ -318,6 +371,7 @@ bool TgaFormat::onSave(FileOp* fop)
   TgaDelegate delegate(fop);
   encoder.writeImage(header, tgaImage);
   encoder.writeFooter();
+  finterface.flush();
 
   if (ferror(handle.get())) {
     fop->setError("Error writing file.\n");
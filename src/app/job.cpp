@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -38,6 +38,7 @@ Job::Job(const char* jobName)
   m_last_progress = 0.0;
   m_done_flag = false;
   m_canceled_flag = false;
+  m_background_flag = false;
 
   if (App::instance()->isGui()) {
     m_alert_window = ui::Alert::create(
@@ -71,7 +72,7 @@ void Job::startJob()
     // The job was canceled by the user?
     {
       std::unique_lock<std::mutex> hold(m_mutex);
-      if (!m_done_flag)
+      if (!m_done_flag && !m_background_flag)
         m_canceled_flag = true;
     }
 
@@ -105,6 +106,18 @@ void Job::waitJob()
   }
 }
 
+void Job::continueInBackground()
+{
+  std::unique_lock<std::mutex> hold(m_mutex);
+  m_background_flag = true;
+
+  if (m_timer && m_timer->isRunning())
+    m_timer->stop();
+
+  if (m_alert_window)
+    m_alert_window->closeWindow(NULL);
+}
+
 void Job::jobProgress(double f)
 {
   m_last_progress = f;
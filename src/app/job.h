@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -32,6 +32,12 @@ namespace app {
 
     void waitJob();
 
+    // Closes the progress window so startJob() returns while onJob()
+    // is still running (the job is not canceled). It can be called
+    // from onMonitoringTick(), and waitJob() must be called anyway
+    // to finish the job.
+    void continueInBackground();
+
     // The onJob() can use this function to report progress of the
     // background job being done. 1.0 is completed.
     void jobProgress(double f);
@@ -66,6 +72,7 @@ namespace app {
     std::atomic<double> m_last_progress;
     bool m_done_flag;
     bool m_canceled_flag;
+    bool m_background_flag;
     std::exception_ptr m_error;
 
     // these methods are privated and not defined
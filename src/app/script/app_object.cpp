@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2015-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -164,6 +164,10 @@ int App_transaction(lua_State* L)
       ContextWriter writer(ctx);
       Tx tx(writer, label);
 
+      // Notifications are sent (merged) at the end of the
+      // transaction, so the UI isn't updated for each modification
+      DocBulkEdit bulkEdit(writer.document());
+
       lua_pushvalue(L, -1);
       if (lua_pcall(L, 0, LUA_MULTRET, 0) == LUA_OK)
         tx.commit();
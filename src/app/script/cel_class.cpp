@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -9,6 +9,7 @@
 #include "config.h"
 #endif
 
+#include "app/cmd/copy_region.h"
 #include "app/cmd/replace_image.h"
 #include "app/cmd/set_cel_opacity.h"
 #include "app/cmd/set_cel_position.h"
@@ -18,6 +19,7 @@
 #include "app/script/engine.h"
 #include "app/script/luacpp.h"
 #include "app/script/userdata.h"
+#include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/sprite.h"
 
@@ -123,6 +125,32 @@ int Cel_set_image(lua_State* L)
 {
   auto cel = get_docobj<Cel>(L, 1);
   auto srcImage = get_image_from_arg(L, 2);
+  Image* dstImage = cel->image();
+
+  // If the new image has the same format/size, we copy only the
+  // modified pixels (so the undo information doesn't contain a copy
+  // of the whole image, and nothing is recorded if there is no
+  // change). Tilemaps, reference layers, and linked cels replace
+  // the whole image.
+  if (!cel->layer()->isTilemap() &&
+      !cel->layer()->isReference() &&
+      cel->links() == 0 &&
+      dstImage->pixelFormat() != IMAGE_TILEMAP &&
+      dstImage->pixelFormat() == srcImage->pixelFormat() &&
+      dstImage->size() == srcImage->size() &&
+      dstImage->maskColor() == srcImage->maskColor()) {
+    gfx::Rect bounds;
+    if (doc::algorithm::shrink_bounds2(dstImage, srcImage,
+                                       dstImage->bounds(), bounds)) {
+      Tx tx(cel->sprite());
+      tx(new cmd::CopyRegion(dstImage, srcImage,
+                             gfx::Region(bounds),
+                             gfx::Point(0, 0)));
+      tx.commit();
+    }
+    return 0;
+  }
+
   ImageRef newImage(Image::createCopy(srcImage));
 
   Tx tx(cel->sprite());
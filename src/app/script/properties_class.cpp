@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2024  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -65,6 +65,23 @@ struct Properties {
     return obj;
   }
 
+  // Read-only access to the user data (doesn't copy shared
+  // properties, see doc::UserData::propertiesMaps())
+  const doc::UserData& userData(lua_State* L) {
+    const doc::WithUserData* obj = object(L);
+    if (ti == doc::notile) {
+      return obj->userData();
+    }
+    else {
+      ASSERT(obj->type() == doc::ObjectType::Tileset);
+      return static_cast<const doc::Tileset*>(obj)->getTileData(ti);
+    }
+  }
+
+  const doc::UserData::Properties& constProperties(lua_State* L) {
+    return userData(L).properties(extID);
+  }
+
   doc::UserData::Properties& properties(lua_State* L, doc::WithUserData* obj = nullptr) {
     if (!obj)
       obj = object(L);
@@ -82,12 +99,20 @@ struct Properties {
 
 };
 
-using PropertiesIterator = doc::UserData::Properties::iterator;
+// The iterator keeps a reference to the iterated properties maps, so
+// if the properties are modified in the middle of the iteration (and
+// copied, as they are shared with this iterator), we continue
+// iterating the original ones.
+struct PropertiesIterator {
+  doc::UserData::PropertiesMapsRef maps;
+  doc::UserData::Properties::const_iterator it;
+  doc::UserData::Properties::const_iterator end;
+};
 
 int Properties_len(lua_State* L)
 {
   auto propObj = get_obj<Properties>(L, 1);
-  auto& properties = propObj->properties(L);
+  auto& properties = propObj->constProperties(L);
   lua_pushinteger(L, properties.size());
   return 1;
 }
@@ -99,7 +124,7 @@ int Properties_index(lua_State* L)
   if (!field)
     return luaL_error(L, "field in 'properties.field' must be a string");
 
-  auto& properties = propObj->properties(L);
+  auto& properties = propObj->constProperties(L);
   auto it = properties.find(field);
   if (it != properties.end()) {
     push_value_to_lua(L, (*it).second);
@@ -121,7 +146,6 @@ int Properties_newindex(lua_State* L)
   if (!obj)
     return luaL_error(L, "the object with these properties was destroyed");
 
-  auto& properties = propObj->properties(L, obj);
   auto newValue = get_value_from_lua<doc::UserData::Variant>(L, 3);
 
   // TODO add Object::sprite() member function
@@ -140,6 +164,7 @@ int Properties_newindex(lua_State* L)
     tx.commit();
   }
   else {
+    auto& properties = propObj->properties(L, obj);
     properties[field] = std::move(newValue);
   }
   return 0;
@@ -188,14 +213,12 @@ int Properties_call(lua_State* L)
 
 int Properties_pairs_next(lua_State* L)
 {
-  auto propObj = get_obj<Properties>(L, 1);
-  auto& properties = propObj->properties(L);
-  auto& it = *get_obj<PropertiesIterator>(L, lua_upvalueindex(1));
-  if (it == properties.end())
+  auto& iter = *get_obj<PropertiesIterator>(L, lua_upvalueindex(1));
+  if (iter.it == iter.end)
     return 0;
-  lua_pushstring(L, (*it).first.c_str());
-  push_value_to_lua(L, (*it).second);
-  ++it;
+  lua_pushstring(L, (*iter.it).first.c_str());
+  push_value_to_lua(L, (*iter.it).second);
+  ++iter.it;
   return 2;
 }
 
@@ -206,9 +229,12 @@ int Properties_pairs(lua_State* L)
   if (!obj)
     return luaL_error(L, "the object with these properties was destroyed");
 
-  auto& properties = propObj->properties(L);
+  const doc::UserData& userData = propObj->userData(L);
+  auto& properties = userData.properties(propObj->extID);
 
-  push_obj(L, properties.begin());
+  push_obj(L, PropertiesIterator{ userData.propertiesMapsRef(),
+                                  properties.begin(),
+                                  properties.end() });
   lua_pushcclosure(L, Properties_pairs_next, 1);
   lua_pushvalue(L, 1); // Copy the same propObj as the second return value
   return 2;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -305,12 +305,20 @@ void ThumbnailGenerator::generateThumbnail(IFileItem* fileitem)
   THUMB_TRACE("Queue FOP thumbnail for %s\n",
               fileitem->fileName().c_str());
 
+  // The loaded document is only used to render the thumbnail, so
+  // cels referencing the same image can share it.
+  FileOpConfig config;
+  if (ui::is_ui_thread())
+    config.fillFromPreferences();
+  config.shareReferencedImages = true;
+
   std::unique_ptr<FileOp> fop(
     FileOp::createLoadDocumentOperation(
       nullptr,
       fileitem->fileName().c_str(),
       FILE_LOAD_SEQUENCE_NONE |
-      FILE_LOAD_ONE_FRAME));
+      FILE_LOAD_ONE_FRAME,
+      &config));
   if (!fop || fop->hasError()) {
     // Set a nullptr thumbnail so we don't try to generate a thumbnail
     // for this fileitem again.
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -177,7 +177,8 @@ public:
       if ((brush->size() != size) ||
           (brush->angle() != angle && m_origBrushType != kCircleBrushType) ||
           (m_hasDynamicGradient && pt.gradient != m_lastGradientValue)) {
-        // TODO cache brushes
+        // The rasterized brush image is shared through the brush
+        // cache (see doc::Brush::regenerate())
         BrushRef newBrush = std::make_shared<Brush>(
           m_origBrushType, size, angle);
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -50,6 +50,7 @@ Transaction::Transaction(
 
   m_doc->add_observer(this);
   m_undo = m_doc->undoHistory();
+  m_notificationsBatch = std::make_unique<DocNotificationsBatch>(m_doc);
 
   m_cmds = new CmdTransaction(label,
                               modification == Modification::ModifyDocument);
@@ -102,6 +103,9 @@ void Transaction::commit()
   m_undo->add(m_cmds);
   m_cmds = nullptr;
 
+  // Send the accumulated notifications
+  m_notificationsBatch.reset();
+
   // Process changes
   if (int(m_changes) & int(Changes::kSelection)) {
     m_doc->resetTransformation();
@@ -140,6 +144,12 @@ void Transaction::rollback(CmdTransaction* newCmds)
 
   m_cmds->undo();
 
+  // Send the accumulated notifications before deleting the Cmds
+  // (which can delete the objects referenced by the notifications)
+  m_notificationsBatch.reset();
+  if (newCmds)
+    m_notificationsBatch = std::make_unique<DocNotificationsBatch>(m_doc);
+
   delete m_cmds;
   m_cmds = newCmds;
 }
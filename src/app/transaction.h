@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -13,12 +13,14 @@
 #include "app/doc_observer.h"
 #include "base/exception.h"
 
+#include <memory>
 #include <string>
 
 namespace app {
 
   class Cmd;
   class Context;
+  class DocNotificationsBatch;
   class DocRange;
   class DocUndo;
 
@@ -44,6 +46,11 @@ namespace app {
   // processes those changes as UI updates (so widgets are
   // invalidated/updated correctly to show the new Doc state).
   //
+  // Notifications about modified objects generated by the Cmds are
+  // accumulated and sent to the observers (merged) when the
+  // transaction is committed or rollbacked (see
+  // Doc::beginNotificationsBatch()).
+  //
   // You have to wrap every call to an transaction with a
   // ContextWriter. The preferred usage is as follows:
   //
@@ -123,6 +130,7 @@ namespace app {
     DocUndo* m_undo;
     CmdTransaction* m_cmds;
     Changes m_changes;
+    std::unique_ptr<DocNotificationsBatch> m_notificationsBatch;
   };
 
 } // namespace app
@@ -16,6 +16,7 @@
 #include "app/cmd/clear_mask.h"
 #include "app/cmd/deselect_mask.h"
 #include "app/cmd/trim_cel.h"
+#include "app/commands/cmd_open_file.h"
 #include "app/commands/commands.h"
 #include "app/console.h"
 #include "app/context_access.h"
@@ -55,6 +56,10 @@ namespace app {
 
 using namespace ui;
 
+// Minimum time between two redraws of the preview editor when the
+// sprite pixels are modified (e.g. while we paint)
+static constexpr int kPreviewRedrawInterval = 1000/30; // In milliseconds
+
 namespace {
 
 // Used to show a view temporarily (the one with the file to be
@@ -227,19 +232,25 @@ DocView::DocView(Doc* document, Type type,
   , m_editor((type == Normal ?
               (Editor*)new AppEditor(document, previewDelegate):
               (Editor*)new PreviewEditor(document)))
+  , m_previewRedrawTimer(kPreviewRedrawInterval)
 {
+  m_previewRedrawTimer.Tick.connect([this]{ onPreviewRedrawTimer(); });
+
   addChild(m_view);
 
   m_view->attachToView(m_editor);
   m_view->setExpansive(true);
 
   m_editor->setDocView(this);
-  m_document->add_observer(this);
+
+  // Immediate observer to show the modified pixels while the user
+  // paints (in the middle of a transaction)
+  m_document->addImmediateObserver(this);
 }
 
 DocView::~DocView()
 {
-  m_document->remove_observer(this);
+  m_document->removeImmediateObserver(this);
   delete m_editor;
 }
 
@@ -352,6 +363,10 @@ bool DocView::onCloseView(Workspace* workspace, bool quitting)
       try_again = false;
   }
 
+  // The loading thread keeps the document locked until it's
+  // completely loaded
+  const bool partiallyLoaded = stop_loading_document(m_document);
+
   try {
     // Destroy the sprite (locking it as writer)
     DocDestroyer destroyer(
@@ -361,9 +376,15 @@ bool DocView::onCloseView(Workspace* workspace, bool quitting)
       0, fmt::format("Sprite '{}' closed.",
                      m_document->name()));
 
+    // A partially loaded document is destroyed (it cannot be reopened
+    // with ReopenClosedFile command, as it doesn't contain all the
+    // frames of its file)
+    if (partiallyLoaded)
+      destroyer.destroyDocument();
     // Just close the document (so we can reopen it with
     // ReopenClosedFile command).
-    destroyer.closeDocument();
+    else
+      destroyer.closeDocument();
 
     // At this point the view is already destroyed
     return true;
@@ -407,8 +428,39 @@ void DocView::onGeneralUpdate(DocEvent& ev)
 void DocView::onSpritePixelsModified(DocEvent& ev)
 {
   if (m_editor->isVisible() &&
-      m_editor->frame() == ev.frame())
-    m_editor->drawSpriteClipped(ev.region());
+      m_editor->frame() == ev.frame()) {
+    // The preview is redrawn later, so the rendering of the preview
+    // doesn't slow down the painting in the main editor
+    if (m_type == Preview) {
+      m_previewDirtyRegion |= ev.region();
+      if (!m_previewRedrawTimer.isRunning())
+        m_previewRedrawTimer.start();
+    }
+    else
+      m_editor->drawSpriteClipped(ev.region());
+  }
+}
+
+void DocView::onPreviewRedrawTimer()
+{
+  m_previewRedrawTimer.stop();
+
+  if (!m_editor->isVisible()) {
+    m_previewDirtyRegion.clear();
+    return;
+  }
+
+  try {
+    // Don't wait if the document is locked (e.g. a filter is being
+    // applied in a background thread), we'll try again in the next
+    // tick.
+    DocReader reader(m_document, 0);
+    m_editor->drawSpriteClipped(m_previewDirtyRegion);
+    m_previewDirtyRegion.clear();
+  }
+  catch (const LockedDocException&) {
+    m_previewRedrawTimer.start();
+  }
 }
 
 void DocView::onLayerMergedDown(DocEvent& ev)
@@ -13,7 +13,9 @@
 #include "app/ui/input_chain_element.h"
 #include "app/ui/tabs.h"
 #include "app/ui/workspace_view.h"
+#include "gfx/region.h"
 #include "ui/box.h"
+#include "ui/timer.h"
 
 namespace doc {
   class Layer;
@@ -111,6 +113,7 @@ namespace app {
 
   private:
     bool hasContentInActiveFrame(const doc::Layer* layer) const;
+    void onPreviewRedrawTimer();
 
     Type m_type;
     Doc* m_document;
@@ -118,6 +121,14 @@ namespace app {
     DocViewPreviewDelegate* m_previewDelegate;
     Editor* m_editor;
     gfx::Point m_timelineScroll;
+
+    // In Preview mode, the modified pixels are accumulated in
+    // m_previewDirtyRegion and redrawn when m_previewRedrawTimer
+    // ticks, so the preview is redrawn at most once per tick (instead
+    // of once per each modification of the sprite, e.g. each step of
+    // the tool loop while we paint in the main editor).
+    ui::Timer m_previewRedrawTimer;
+    gfx::Region m_previewDirtyRegion;
   };
 
 } // namespace app
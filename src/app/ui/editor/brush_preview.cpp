@@ -17,6 +17,7 @@
 #include "app/color.h"
 #include "app/color_utils.h"
 #include "app/doc.h"
+#include "app/doc_undo.h"
 #include "app/snap_to_grid.h"
 #include "app/tools/controller.h"
 #include "app/tools/ink.h"
@@ -136,8 +137,13 @@ color_t BrushPreview::getBrushColor(Sprite* sprite, Layer* layer)
 //      a way to simplify all possibilities
 void BrushPreview::show(const gfx::Point& screenPos)
 {
+  // Area of the old brush preview that must be redrawn (it's
+  // invalidated together with the new brush preview area, so the
+  // editor is repainted just one time)
+  gfx::Region invalidRegion;
+
   if (m_onScreen)
-    hide();
+    hide(&invalidRegion);
 
   Doc* document = m_editor->document();
   Sprite* sprite = m_editor->sprite();
@@ -376,10 +382,15 @@ void BrushPreview::show(const gfx::Point& screenPos)
     }
 
     if (layer) {
-      render::Render().renderLayer(
-        extraImage, layer, site.frame(),
-        gfx::Clip(0, 0, extraCelBoundsInCanvas),
-        BlendMode::SRC);
+      if (extraImage->pixelFormat() == IMAGE_TILEMAP) {
+        m_render.renderLayer(
+          extraImage, layer, site.frame(),
+          gfx::Clip(0, 0, extraCelBoundsInCanvas),
+          BlendMode::SRC);
+      }
+      else {
+        renderLayerWithCache(extraImage, site, extraCelBoundsInCanvas);
+      }
 
       // This extra cel is a patch for the current layer/frame
       m_extraCel->setType(render::ExtraType::PATCH);
@@ -404,12 +415,21 @@ void BrushPreview::show(const gfx::Point& screenPos)
       }
     }
 
-    document->notifySpritePixelsModified(
-      sprite, gfx::Region(m_lastBounds = extraCelBoundsInCanvas),
-      m_lastFrame = site.frame());
+    if (!invalidRegion.isEmpty() && m_lastFrame != site.frame()) {
+      notifyPreviewPixels(document, sprite, invalidRegion, m_lastFrame);
+      invalidRegion.clear();
+    }
+    invalidRegion |= gfx::Region(m_lastBounds = extraCelBoundsInCanvas);
+    notifyPreviewPixels(document, sprite, invalidRegion,
+                        m_lastFrame = site.frame());
+    invalidRegion.clear();
 
     m_withRealPreview = true;
   }
+  // Invalidate the old brush preview area
+  else if (!invalidRegion.isEmpty()) {
+    notifyPreviewPixels(document, sprite, invalidRegion, m_lastFrame);
+  }
 
   // Save area and draw the cursor
   if (!(m_type & NATIVE_CROSSHAIR) ||
@@ -447,6 +467,11 @@ void BrushPreview::show(const gfx::Point& screenPos)
 // (m_cursorEditor). So you must to use this routine only if you
 // called showBrushPreview() before.
 void BrushPreview::hide()
+{
+  hide(nullptr);
+}
+
+void BrushPreview::hide(gfx::Region* pendingInvalidation)
 {
   if (!m_onScreen)
     return;
@@ -482,8 +507,13 @@ void BrushPreview::hide()
 
     if (document && sprite) {
       document->setExtraCel(ExtraCelRef(nullptr));
-      document->notifySpritePixelsModified(
-        sprite, gfx::Region(m_lastBounds), m_lastFrame);
+
+      // The caller (show()) will invalidate this area
+      if (pendingInvalidation)
+        *pendingInvalidation |= gfx::Region(m_lastBounds);
+      else
+        notifyPreviewPixels(document, sprite,
+                            gfx::Region(m_lastBounds), m_lastFrame);
     }
 
     m_withRealPreview = false;
@@ -514,6 +544,90 @@ void BrushPreview::redraw()
   }
 }
 
+void BrushPreview::onSpritePixelsModified()
+{
+  if (!m_notifyingPreviewPixels)
+    discardLayerCache();
+}
+
+void BrushPreview::discardLayerCache()
+{
+  m_layerCacheBounds = gfx::Rect();
+}
+
+void BrushPreview::notifyPreviewPixels(Doc* document,
+                                       Sprite* sprite,
+                                       const gfx::Region& region,
+                                       const frame_t frame)
+{
+  base::ScopedValue notifying(m_notifyingPreviewPixels, true);
+  document->notifySpritePixelsModified(sprite, region, frame);
+}
+
+void BrushPreview::renderLayerWithCache(Image* dstImage,
+                                        const Site& site,
+                                        const gfx::Rect& bounds)
+{
+  const Layer* layer = site.layer();
+  const Cel* cel = site.cel();
+  const Doc* doc = site.document();
+
+  LayerCacheKey key;
+  key.layer = layer;
+  key.frame = site.frame();
+  key.structureVersion = site.sprite()->structureVersion();
+  key.undoState = doc->undoHistory()->currentState();
+  if (cel) {
+    key.imageId = cel->image()->id();
+    key.imageVersion = cel->image()->version();
+    key.celDataVersion = cel->data()->version();
+  }
+
+  if (!m_layerCache ||
+      m_layerCache->pixelFormat() != dstImage->pixelFormat() ||
+      m_layerCacheKey != key) {
+    m_layerCacheBounds = gfx::Rect();
+    m_layerCacheKey = key;
+  }
+
+  // Create the new cache with the given bounds, reusing the pixels
+  // that we already have from the previous cache
+  if (!m_layerCacheBounds.contains(bounds)) {
+    if (!m_layerCacheTmp ||
+        m_layerCacheTmp->pixelFormat() != dstImage->pixelFormat() ||
+        m_layerCacheTmp->width() != bounds.w ||
+        m_layerCacheTmp->height() != bounds.h) {
+      m_layerCacheTmp.reset(
+        Image::create(dstImage->pixelFormat(), bounds.w, bounds.h));
+    }
+    m_layerCacheTmp->setMaskColor(dstImage->maskColor());
+    clear_image(m_layerCacheTmp.get(), dstImage->maskColor());
+
+    gfx::Region newArea(bounds);
+    if (!m_layerCacheBounds.isEmpty()) {
+      copy_image(m_layerCacheTmp.get(), m_layerCache.get(),
+                 m_layerCacheBounds.x - bounds.x,
+                 m_layerCacheBounds.y - bounds.y);
+      newArea.createSubtraction(newArea, gfx::Region(m_layerCacheBounds));
+    }
+
+    // Render only the new exposed areas
+    for (const gfx::Rect& rc : newArea) {
+      m_render.renderLayer(
+        m_layerCacheTmp.get(), layer, site.frame(),
+        gfx::Clip(rc.x - bounds.x, rc.y - bounds.y, rc),
+        BlendMode::SRC);
+    }
+
+    std::swap(m_layerCache, m_layerCacheTmp);
+    m_layerCacheBounds = bounds;
+  }
+
+  copy_image(dstImage, m_layerCache.get(),
+             m_layerCacheBounds.x - bounds.x,
+             m_layerCacheBounds.y - bounds.y);
+}
+
 void BrushPreview::invalidateRegion(const gfx::Region& region)
 {
   m_clippingRegion.createSubtraction(m_clippingRegion, region);
@@ -558,6 +672,15 @@ void BrushPreview::generateBoundaries(const Site& site,
   Image* brushImage = brush->image();
   m_brushGen = brush->gen();
 
+  // Reuse the boundaries cached in the brush itself (shared between
+  // all brushes with the same type/size/angle)
+  if (tilemapMode == TilemapMode::Pixels && !isOnePixel) {
+    m_brushBoundaries = brush->boundaries();
+    m_brushBoundaries.offset(-brush->center().x,
+                             -brush->center().y);
+    return;
+  }
+
   Image* mask = nullptr;
   bool deleteMask = true;
   if (tilemapMode == TilemapMode::Tiles) {
@@ -13,12 +13,16 @@
 #include "doc/brush.h"
 #include "doc/color.h"
 #include "doc/frame.h"
+#include "doc/image_ref.h"
 #include "doc/mask_boundaries.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
 #include "gfx/color.h"
 #include "gfx/point.h"
 #include "gfx/rect.h"
 #include "gfx/region.h"
 #include "os/surface.h"
+#include "render/render.h"
 #include "ui/cursor.h"
 
 #include <vector>
@@ -28,11 +32,16 @@ namespace doc {
   class Sprite;
 }
 
+namespace undo {
+  class UndoState;
+}
+
 namespace ui {
   class Graphics;
 }
 
 namespace app {
+  class Doc;
   class Editor;
   class Site;
 
@@ -85,6 +94,12 @@ namespace app {
 
     void invalidateRegion(const gfx::Region& region);
 
+    // Discards the cached render of the layer below the brush preview
+    // when the sprite pixels are modified (except when they are
+    // notified by the brush preview itself).
+    void onSpritePixelsModified();
+    void discardLayerCache();
+
   private:
     typedef void (BrushPreview::*PixelDelegate)(ui::Graphics*, const gfx::Point&, gfx::Color);
 
@@ -99,6 +114,21 @@ namespace app {
     void generateBoundaries(const Site& site,
                             const gfx::Point& spritePos);
 
+    // Renders the given layer area in dstImage using (and updating)
+    // m_layerCache, so only the areas that weren't visible in the
+    // previous brush position are rendered again.
+    void renderLayerWithCache(doc::Image* dstImage,
+                              const Site& site,
+                              const gfx::Rect& bounds);
+
+    void hide(gfx::Region* pendingInvalidation);
+
+    // Notifies the pixels modified by the brush preview itself.
+    void notifyPreviewPixels(Doc* document,
+                             doc::Sprite* sprite,
+                             const gfx::Region& region,
+                             doc::frame_t frame);
+
     // Creates a little native cursor to draw the CROSSHAIR
     void createCrosshairCursor(ui::Graphics* g, const gfx::Color cursorColor);
 
@@ -152,6 +182,42 @@ namespace app {
     TilemapMode m_lastTilemapMode;
 
     ExtraCelRef m_extraCel;
+
+    // Used to render the layer below the brush preview.
+    render::Render m_render;
+
+    // Cache of the last rendered layer area (m_layerCacheBounds in
+    // canvas coordinates) to avoid rendering the whole brush area on
+    // each mouse movement. m_layerCacheTmp is the image used to
+    // create the next cache (so we don't allocate a new image each
+    // time). The cache is valid while the key doesn't change.
+    struct LayerCacheKey {
+      const doc::Layer* layer = nullptr;
+      doc::frame_t frame = -1;
+      doc::ObjectVersion structureVersion = 0;
+      const undo::UndoState* undoState = nullptr;
+      doc::ObjectId imageId = doc::NullId;
+      doc::ObjectVersion imageVersion = 0;
+      doc::ObjectVersion celDataVersion = 0;
+
+      bool operator==(const LayerCacheKey& o) const {
+        return (layer == o.layer &&
+                frame == o.frame &&
+                structureVersion == o.structureVersion &&
+                undoState == o.undoState &&
+                imageId == o.imageId &&
+                imageVersion == o.imageVersion &&
+                celDataVersion == o.celDataVersion);
+      }
+      bool operator!=(const LayerCacheKey& o) const {
+        return !operator==(o);
+      }
+    };
+    LayerCacheKey m_layerCacheKey;
+    bool m_notifyingPreviewPixels = false;
+    doc::ImageRef m_layerCache;
+    doc::ImageRef m_layerCacheTmp;
+    gfx::Rect m_layerCacheBounds;
   };
 
   class HideBrushPreview {
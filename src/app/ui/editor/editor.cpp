@@ -2378,6 +2378,11 @@ void Editor::onShowExtrasChange()
   invalidate();
 }
 
+void Editor::onGeneralUpdate(DocEvent& ev)
+{
+  m_brushPreview.discardLayerCache();
+}
+
 void Editor::onColorSpaceChanged(DocEvent& ev)
 {
   // As the document has a new color space, we've to redraw the
@@ -2385,6 +2390,12 @@ void Editor::onColorSpaceChanged(DocEvent& ev)
   invalidate();
 }
 
+void Editor::onSpritePixelsModified(DocEvent& ev)
+{
+  if (ev.sprite() == m_sprite)
+    m_brushPreview.onSpritePixelsModified();
+}
+
 void Editor::onExposeSpritePixels(DocEvent& ev)
 {
   if (m_state && ev.sprite() == m_sprite)
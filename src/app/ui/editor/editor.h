@@ -343,7 +343,9 @@ namespace app {
     void onShowExtrasChange();
 
     // DocObserver impl
+    void onGeneralUpdate(DocEvent& ev) override;
     void onColorSpaceChanged(DocEvent& ev) override;
+    void onSpritePixelsModified(DocEvent& ev) override;
     void onExposeSpritePixels(DocEvent& ev) override;
     void onSpritePixelRatioChanged(DocEvent& ev) override;
     void onBeforeRemoveLayer(DocEvent& ev) override;
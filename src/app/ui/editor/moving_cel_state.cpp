@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2022  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -13,6 +13,7 @@
 
 #include "app/app.h"
 #include "app/cmd/set_cel_bounds.h"
+#include "app/cmd/set_cels_position.h"
 #include "app/commands/command.h"
 #include "app/context_access.h"
 #include "app/doc_api.h"
@@ -34,6 +35,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
 
 namespace app {
 
@@ -157,6 +159,10 @@ bool MovingCelState::onMouseUp(Editor* editor, MouseMessage* msg)
       DocApi api = document->getApi(tx);
       gfx::Point intOffset = intCelOffset();
 
+      // All the cels (from non-reference layers) are moved with just
+      // one undo record
+      auto setCelsPosition = std::make_unique<cmd::SetCelsPosition>();
+
       // And now we move the cel (or all selected range) to the new position.
       for (Cel* cel : m_celList) {
         // Change reference layer with subpixel precision
@@ -171,11 +177,11 @@ bool MovingCelState::onMouseUp(Editor* editor, MouseMessage* msg)
           tx(new cmd::SetCelBoundsF(cel, celBounds));
         }
         else {
-          api.setCelPosition(writer.sprite(), cel,
-                             cel->x() + intOffset.x,
-                             cel->y() + intOffset.y);
+          setCelsPosition->addCel(cel, cel->position() + intOffset);
         }
       }
+      if (!setCelsPosition->empty())
+        tx(setCelsPosition.release());
 
       // Move selection if it was visible
       if (m_maskVisible) {
@@ -1730,6 +1730,13 @@ void Timeline::onPaint(ui::PaintEvent& ev)
     getDrawableLayers(&firstLayer, &lastLayer);
     getDrawableFrames(&firstFrame, &lastFrame);
 
+    // Draw only the rows/columns inside the clipping area (e.g. when
+    // the mouse hovers a cel, only the old/new hovered cels are
+    // invalidated and repainted)
+    clipDrawableLayersAndFrames(g->getClipBounds(),
+                                &firstLayer, &lastLayer,
+                                &firstFrame, &lastFrame);
+
     drawTop(g);
 
     // Draw the header for layers.
@@ -1796,28 +1803,12 @@ void Timeline::onPaint(ui::PaintEvent& ev)
           data.firstLink = data.activeIt;
           data.lastLink = data.activeIt;
 
-          ObjectId imageId = (*data.activeIt)->image()->id();
-
-          auto it2 = data.activeIt;
-          if (it2 != data.begin) {
-            do {
-              --it2;
-              if ((*it2)->image()->id() == imageId) {
-                data.firstLink = it2;
-                if ((*data.firstLink)->frame() < firstFrame)
-                  break;
-              }
-            } while (it2 != data.begin);
-          }
-
-          it2 = data.activeIt;
-          while (it2 != data.end) {
-            if ((*it2)->image()->id() == imageId) {
-              data.lastLink = it2;
-              if ((*data.lastLink)->frame() > lastFrame)
-                break;
-            }
-            ++it2;
+          // Use the index of linked cels of the layer to get the
+          // first/last links without iterating all cels
+          if (const CelList* links =
+                layerImagePtr->linkedCels((*data.activeIt)->data())) {
+            data.firstLink = layerImagePtr->findCelIterator(links->front()->frame());
+            data.lastLink = layerImagePtr->findCelIterator(links->back()->frame());
           }
         }
       }
@@ -2139,6 +2130,33 @@ void Timeline::getDrawableFrames(frame_t* firstFrame, frame_t* lastFrame)
       + getCelsBounds().w) / frameBoxWidth());
 }
 
+void Timeline::clipDrawableLayersAndFrames(const gfx::Rect& clip,
+                                           layer_t* firstDrawableLayer,
+                                           layer_t* lastDrawableLayer,
+                                           frame_t* firstDrawableFrame,
+                                           frame_t* lastDrawableFrame)
+{
+  if (m_rows.empty() || clip.isEmpty())
+    return;
+
+  // Position of the cel in the first frame of the last layer (the
+  // top row), the other cels are in a grid from this one (see
+  // getPartBounds() for PART_CEL).
+  const gfx::Rect origin = getPartBounds(Hit(PART_CEL, lastLayer(), 0));
+  const int fw = frameBoxWidth();
+  const int lh = layerBoxHeight();
+
+  const int col1 = (clip.x - origin.x) / fw;
+  const int col2 = (clip.x2() - 1 - origin.x) / fw;
+  *firstDrawableFrame = std::max(*firstDrawableFrame, frame_t(col1));
+  *lastDrawableFrame = std::min(*lastDrawableFrame, frame_t(col2));
+
+  const int row1 = (clip.y - origin.y) / lh;
+  const int row2 = (clip.y2() - 1 - origin.y) / lh;
+  *firstDrawableLayer = std::max(*firstDrawableLayer, lastLayer() - row2);
+  *lastDrawableLayer = std::min(*lastDrawableLayer, lastLayer() - row1);
+}
+
 void Timeline::drawPart(ui::Graphics* g, const gfx::Rect& bounds,
                         const std::string* text, ui::Style* style,
                         const bool is_active,
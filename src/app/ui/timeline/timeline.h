@@ -280,6 +280,9 @@ namespace app {
     void setCursor(ui::Message* msg, const Hit& hit);
     void getDrawableLayers(layer_t* firstLayer, layer_t* lastLayer);
     void getDrawableFrames(frame_t* firstFrame, frame_t* lastFrame);
+    void clipDrawableLayersAndFrames(const gfx::Rect& clip,
+                                     layer_t* firstLayer, layer_t* lastLayer,
+                                     frame_t* firstFrame, frame_t* lastFrame);
     void drawPart(ui::Graphics* g, const gfx::Rect& bounds,
                   const std::string* text,
                   ui::Style* style,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022  Igara Studio S.A.
+// Copyright (C) 2022-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,87 +21,146 @@
 #include "ft/hb_shaper.h"
 #include "ft/lib.h"
 
+#include <list>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 
 namespace app {
 
+namespace {
+
+// A font face opened with a specific size/antialias configuration.
+struct FaceEntry {
+  std::string fontfile;
+  int fontsize;
+  bool antialias;
+  std::unique_ptr<ft::Face> face;
+};
+
+// Keeps the last used font faces opened, so rendering the same text
+// again (e.g. each time the Paste Text preview changes, or from a
+// script generating several labels) doesn't need to open/parse the
+// font file again.
+class FontCache {
+public:
+  static FontCache& instance() {
+    static FontCache cache;
+    return cache;
+  }
+
+  std::mutex& mutex() { return m_mutex; }
+
+  // Returns nullptr if the font cannot be loaded. The mutex() must be
+  // locked while the returned entry is used.
+  FaceEntry* face(const std::string& fontfile,
+                  const int fontsize,
+                  const bool antialias) {
+    for (auto it=m_faces.begin(); it!=m_faces.end(); ++it) {
+      if (it->fontfile == fontfile &&
+          it->fontsize == fontsize &&
+          it->antialias == antialias) {
+        if (it != m_faces.begin())
+          m_faces.splice(m_faces.begin(), m_faces, it);
+        return &m_faces.front();
+      }
+    }
+
+    auto face = std::make_unique<ft::Face>(m_lib.open(fontfile));
+    if (!face->isValid())
+      return nullptr;
+
+    face->setSize(fontsize);
+    face->setAntialias(antialias);
+
+    m_faces.push_front(FaceEntry{ fontfile, fontsize, antialias,
+                                  std::move(face) });
+    if (m_faces.size() > kMaxFaces)
+      m_faces.pop_back();
+    return &m_faces.front();
+  }
+
+private:
+  static constexpr size_t kMaxFaces = 8;
+
+  std::mutex m_mutex;
+  ft::Lib m_lib;                // Must be destroyed after all faces
+  std::list<FaceEntry> m_faces; // Most recently used first
+};
+
+// Blends the glyph coverage with the given color in the image, one
+// row at a time. Non-antialiased glyphs are 1bpp bitmaps.
+void blend_glyph(doc::Image* image,
+                 const ft::Glyph* glyph,
+                 const int x, const int y,
+                 const doc::color_t color,
+                 const bool antialias)
+{
+  const FT_Bitmap* bmp = glyph->bitmap;
+  const gfx::Rect bounds =
+    (gfx::Rect(x, y, int(bmp->width), int(bmp->rows)) & image->bounds());
+  if (bounds.isEmpty())
+    return;
+
+  const doc::color_t rgb = (color & doc::rgba_rgb_mask);
+  const int alpha = doc::rgba_geta(color);
+  int t;
+
+  for (int v=bounds.y; v<bounds.y2(); ++v) {
+    const uint8_t* p = bmp->buffer + (v-y)*bmp->pitch;
+    auto dst = (doc::color_t*)image->getPixelAddress(bounds.x, v);
+
+    for (int u=bounds.x-x; u<bounds.x2()-x; ++u, ++dst) {
+      const int src_alpha =
+        (antialias ? p[u]:
+                     (p[u>>3] & (0x80 >> (u&7)) ? 255: 0));
+      const int output_alpha = MUL_UN8(alpha, src_alpha, t);
+      if (output_alpha) {
+        *dst = doc::rgba_blender_normal(
+          *dst, rgb | (output_alpha << doc::rgba_a_shift));
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
 doc::Image* render_text(const std::string& fontfile, int fontsize,
                         const std::string& text,
                         doc::color_t color,
                         bool antialias)
 {
-  std::unique_ptr<doc::Image> image(nullptr);
-  ft::Lib ft;
-
-  ft::Face face(ft.open(fontfile));
-  if (face.isValid()) {
-    // Set font size
-    face.setSize(fontsize);
-    face.setAntialias(antialias);
-
-    // Calculate text size
-    gfx::Rect bounds = ft::calc_text_bounds(face, text);
-
-    // Render the image and copy it to the clipboard
-    if (!bounds.isEmpty()) {
-      image.reset(doc::Image::create(doc::IMAGE_RGB, bounds.w, bounds.h));
-      doc::clear_image(image.get(), 0);
-
-      ft::ForEachGlyph<ft::Face> feg(face, text);
-      while (feg.next()) {
-        auto glyph = feg.glyph();
-        if (!glyph)
-          continue;
-
-        int t, yimg = - bounds.y + int(glyph->y);
-
-        for (int v=0; v<int(glyph->bitmap->rows); ++v, ++yimg) {
-          const uint8_t* p = glyph->bitmap->buffer + v*glyph->bitmap->pitch;
-          int ximg = - bounds.x + int(glyph->x);
-          int bit = 0;
-
-          for (int u=0; u<int(glyph->bitmap->width); ++u, ++ximg) {
-            int alpha;
-
-            if (antialias) {
-              alpha = *(p++);
-            }
-            else {
-              alpha = ((*p) & (1 << (7 - (bit++))) ? 255: 0);
-              if (bit == 8) {
-                bit = 0;
-                ++p;
-              }
-            }
-
-            int output_alpha = MUL_UN8(doc::rgba_geta(color), alpha, t);
-            if (output_alpha) {
-              doc::color_t output_color =
-                doc::rgba(doc::rgba_getr(color),
-                          doc::rgba_getg(color),
-                          doc::rgba_getb(color),
-                          output_alpha);
-
-              doc::put_pixel(
-                image.get(), ximg, yimg,
-                doc::rgba_blender_normal(
-                  doc::get_pixel(image.get(), ximg, yimg),
-                  output_color));
-            }
-          }
-        }
-      }
-    }
-    else {
-      throw std::runtime_error("There is no text");
-    }
-  }
-  else {
+  FontCache& cache = FontCache::instance();
+  std::lock_guard lock(cache.mutex());
+
+  FaceEntry* entry = cache.face(fontfile, fontsize, antialias);
+  if (!entry)
     throw std::runtime_error("Error loading font face");
+
+  ft::Face& face = *entry->face;
+
+  // Calculate text size
+  gfx::Rect bounds = ft::calc_text_bounds(face, text);
+  if (bounds.isEmpty())
+    throw std::runtime_error("There is no text");
+
+  std::unique_ptr<doc::Image> image(
+    doc::Image::create(doc::IMAGE_RGB, bounds.w, bounds.h));
+  doc::clear_image(image.get(), 0);
+
+  ft::ForEachGlyph<ft::Face> feg(face, text);
+  while (feg.next()) {
+    auto glyph = feg.glyph();
+    if (!glyph)
+      continue;
+
+    blend_glyph(image.get(), glyph,
+                - bounds.x + int(glyph->x),
+                - bounds.y + int(glyph->y),
+                color, antialias);
   }
 
-  return (image ? image.release(): nullptr);
+  return image.release();
 }
 
 } // namespace app
@@ -0,0 +1,77 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/font_path.h"
+#include "app/util/freetype_utils.h"
+#include "base/fs.h"
+#include "base/string.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <memory>
+#include <string>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+// Returns the first TrueType font found in the system font dirs.
+std::string find_any_ttf_font()
+{
+  base::paths fontDirs;
+  get_font_dirs(fontDirs);
+
+  for (const std::string& dir : fontDirs) {
+    for (const auto& file : base::list_files(dir)) {
+      if (base::string_to_lower(base::get_file_extension(file)) == "ttf")
+        return base::join_path(dir, file);
+    }
+  }
+  return std::string();
+}
+
+} // anonymous namespace
+
+// Rendering the same text with a cached font face (or after the face
+// was discarded from the cache) must give the same result.
+TEST(FreeTypeUtils, FaceCache)
+{
+  const std::string fontfile = find_any_ttf_font();
+  if (fontfile.empty())
+    GTEST_SKIP() << "No TrueType font found";
+
+  const std::string text = "iAiAAiiA";
+  const color_t color = rgba(0, 0, 0, 255);
+  const int fontsize = 13;
+
+  for (const bool antialias : { true, false }) {
+    auto render = [&](const std::string& str, const int size) {
+      return std::unique_ptr<Image>(
+        render_text(fontfile, size, str, color, antialias));
+    };
+
+    auto expected = render(text, fontsize);
+
+    // Render with the cached face
+    auto result = render(text, fontsize);
+    ASSERT_EQ(expected->size(), result->size());
+    EXPECT_EQ(0, count_diff_between_images(expected.get(), result.get()))
+      << "antialias=" << antialias;
+
+    // Render other texts with several sizes so the cached face is
+    // discarded
+    for (int size=fontsize+1; size<fontsize+16; ++size)
+      render("A", size);
+
+    result = render(text, fontsize);
+    ASSERT_EQ(expected->size(), result->size());
+    EXPECT_EQ(0, count_diff_between_images(expected.get(), result.get()))
+      << "antialias=" << antialias;
+  }
+}
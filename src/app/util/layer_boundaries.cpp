@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -24,78 +24,207 @@
 #include "doc/layer.h"
 #include "doc/mask.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 using namespace doc;
 
 namespace app {
 
-void select_layer_boundaries(Layer* layer,
-                             const frame_t frame,
-                             const SelectLayerBoundariesOp op)
+namespace {
+
+// A run of opaque pixels [x1, x2) in the row y (cel image
+// coordinates).
+struct Run {
+  int y, x1, x2;
+  Run(int y, int x1, int x2) : y(y), x1(x1), x2(x2) { }
+};
+
+// How to know if pixels are opaque for each color mode. The "Word"
+// functions check 64 bits (several pixels) at the same time to skip
+// completely transparent/opaque zones quickly.
+template<typename ImageTraits>
+struct OpaquePixels;
+
+template<>
+struct OpaquePixels<RgbTraits> {
+  // Alpha >= 128 is the most significant bit of each pixel
+  // TODO configurable threshold
+  static constexpr uint64_t kAlphaBits = 0x8000000080000000ull;
+  explicit OpaquePixels(color_t) { }
+  bool pixel(color_t c) const { return (rgba_geta(c) >= 128); }
+  bool transparentWord(uint64_t w) const { return (w & kAlphaBits) == 0; }
+  bool opaqueWord(uint64_t w) const { return (w & kAlphaBits) == kAlphaBits; }
+};
+
+template<>
+struct OpaquePixels<GrayscaleTraits> {
+  // TODO configurable threshold
+  static constexpr uint64_t kAlphaBits = 0x8000800080008000ull;
+  explicit OpaquePixels(color_t) { }
+  bool pixel(color_t c) const { return (graya_geta(c) >= 128); }
+  bool transparentWord(uint64_t w) const { return (w & kAlphaBits) == 0; }
+  bool opaqueWord(uint64_t w) const { return (w & kAlphaBits) == kAlphaBits; }
+};
+
+template<>
+struct OpaquePixels<IndexedTraits> {
+  explicit OpaquePixels(color_t maskColor)
+    : m_maskColor(maskColor)
+    , m_maskWord(0x0101010101010101ull * (maskColor & 0xff)) { }
+  bool pixel(color_t c) const { return (c != m_maskColor); }
+  bool transparentWord(uint64_t w) const { return w == m_maskWord; }
+  bool opaqueWord(uint64_t w) const {
+    // True if there is no byte equal to the mask color
+    w ^= m_maskWord;
+    return ((w - 0x0101010101010101ull) & ~w & 0x8080808080808080ull) == 0;
+  }
+private:
+  color_t m_maskColor;
+  uint64_t m_maskWord;
+};
+
+// Collects the runs of opaque pixels of the whole image, returning
+// the bounds (in image coordinates) of the opaque area.
+template<typename ImageTraits>
+gfx::Rect collect_opaque_runs(const Image* image,
+                              std::vector<Run>& runs)
 {
-  Mask newMask;
+  using pixel_t = typename ImageTraits::pixel_t;
+  using const_address_t = typename ImageTraits::const_address_t;
+  constexpr int kPixelsPerWord = sizeof(uint64_t) / sizeof(pixel_t);
 
-  const Cel* cel = layer->cel(frame);
-  if (cel) {
-    const Image* image = cel->image();
-    if (image) {
-      newMask.replace(cel->bounds());
-      newMask.freeze();
-      {
-        LockImageBits<BitmapTraits> maskBits(newMask.bitmap());
-        auto maskIt = maskBits.begin();
-        auto maskEnd = maskBits.end();
-
-        switch (image->pixelFormat()) {
-
-          case IMAGE_RGB: {
-            LockImageBits<RgbTraits> rgbBits(image);
-            auto rgbIt = rgbBits.begin();
-#if _DEBUG
-            auto rgbEnd = rgbBits.end();
-#endif
-            for (; maskIt != maskEnd; ++maskIt, ++rgbIt) {
-              ASSERT(rgbIt != rgbEnd);
-              color_t c = *rgbIt;
-              *maskIt = (rgba_geta(c) >= 128); // TODO configurable threshold
-            }
-            break;
-          }
+  const OpaquePixels<ImageTraits> opaque(image->maskColor());
+  const int w = image->width();
+  const int h = image->height();
+  int x1 = w, y1 = h, x2 = -1, y2 = -1;
 
-          case IMAGE_GRAYSCALE: {
-            LockImageBits<GrayscaleTraits> grayBits(image);
-            auto grayIt = grayBits.begin();
-#if _DEBUG
-            auto grayEnd = grayBits.end();
-#endif
-            for (; maskIt != maskEnd; ++maskIt, ++grayIt) {
-              ASSERT(grayIt != grayEnd);
-              color_t c = *grayIt;
-              *maskIt = (graya_geta(c) >= 128); // TODO configurable threshold
-            }
-            break;
-          }
+  for (int y=0; y<h; ++y) {
+    auto row = (const_address_t)image->getPixelAddress(0, y);
+    int runStart = -1;
+    int x = 0;
 
-          case IMAGE_INDEXED: {
-            const doc::color_t maskColor = image->maskColor();
-            LockImageBits<IndexedTraits> idxBits(image);
-            auto idxIt = idxBits.begin();
-#if _DEBUG
-            auto idxEnd = idxBits.end();
-#endif
-            for (; maskIt != maskEnd; ++maskIt, ++idxIt) {
-              ASSERT(idxIt != idxEnd);
-              color_t c = *idxIt;
-              *maskIt = (c != maskColor);
-            }
-            break;
+    while (x < w) {
+      if (x+kPixelsPerWord <= w) {
+        uint64_t word;
+        std::memcpy(&word, row+x, sizeof(word));
+        if (opaque.transparentWord(word)) {
+          if (runStart >= 0) {
+            runs.emplace_back(y, runStart, x);
+            runStart = -1;
           }
-
+          x += kPixelsPerWord;
+          continue;
+        }
+        else if (opaque.opaqueWord(word)) {
+          if (runStart < 0)
+            runStart = x;
+          x += kPixelsPerWord;
+          continue;
         }
       }
-      newMask.unfreeze();
+
+      if (opaque.pixel(row[x])) {
+        if (runStart < 0)
+          runStart = x;
+      }
+      else if (runStart >= 0) {
+        runs.emplace_back(y, runStart, x);
+        runStart = -1;
+      }
+      ++x;
+    }
+    if (runStart >= 0)
+      runs.emplace_back(y, runStart, w);
+
+    // Update the opaque bounds with the runs of this row
+    if (!runs.empty() && runs.back().y == y) {
+      y1 = std::min(y1, y);
+      y2 = y;
+      x2 = std::max(x2, runs.back().x2);
+      for (auto it=runs.rbegin(); it!=runs.rend() && it->y == y; ++it)
+        x1 = std::min(x1, it->x1);
     }
   }
 
+  if (runs.empty())
+    return gfx::Rect();
+  return gfx::Rect(x1, y1, x2-x1, y2-y1+1);
+}
+
+// Sets the bits [x1, x2) of a row of a mask bitmap (bits are stored
+// from the least significant bit, see ImageImpl<BitmapTraits>).
+void set_bitmap_row_bits(uint8_t* row, int x1, const int x2)
+{
+  for (; x1 < x2 && (x1 & 7); ++x1)
+    row[x1 >> 3] |= (1 << (x1 & 7));
+
+  const int bytes = (x2 - x1) >> 3;
+  if (bytes > 0) {
+    std::memset(row + (x1 >> 3), 0xff, bytes);
+    x1 += (bytes << 3);
+  }
+
+  for (; x1 < x2; ++x1)
+    row[x1 >> 3] |= (1 << (x1 & 7));
+}
+
+} // anonymous namespace
+
+// The mask bitmap only covers the trimmed bounds of the cel content
+// (instead of the whole cel bounds), so the mask boundaries are
+// generated from a smaller bitmap when the layer content is sparse.
+void mask_from_cel(const Cel* cel, Mask& newMask)
+{
+  const Image* image = cel->image();
+  std::vector<Run> runs;
+  gfx::Rect opaqueBounds;
+
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB:
+      opaqueBounds = collect_opaque_runs<RgbTraits>(image, runs);
+      break;
+    case IMAGE_GRAYSCALE:
+      opaqueBounds = collect_opaque_runs<GrayscaleTraits>(image, runs);
+      break;
+    case IMAGE_INDEXED:
+      opaqueBounds = collect_opaque_runs<IndexedTraits>(image, runs);
+      break;
+    default:
+      // Select the whole cel (e.g. tilemaps)
+      newMask.replace(cel->bounds());
+      return;
+  }
+
+  if (opaqueBounds.isEmpty())
+    return;
+
+  const gfx::Point origin = cel->position();
+  newMask.freeze();
+  newMask.reserve(gfx::Rect(opaqueBounds).offset(origin));
+  {
+    Image* bitmap = newMask.bitmap();
+    for (const Run& run : runs) {
+      set_bitmap_row_bits(
+        bitmap->getPixelAddress(0, run.y - opaqueBounds.y),
+        run.x1 - opaqueBounds.x,
+        run.x2 - opaqueBounds.x);
+    }
+  }
+  newMask.unfreeze();
+}
+
+void select_layer_boundaries(Layer* layer,
+                             const frame_t frame,
+                             const SelectLayerBoundariesOp op)
+{
+  Mask newMask;
+
+  const Cel* cel = layer->cel(frame);
+  if (cel && cel->image())
+    mask_from_cel(cel, newMask);
+
   try {
     ContextWriter writer(UIContext::instance());
     Doc* doc = writer.document();
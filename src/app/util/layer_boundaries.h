@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,7 +12,9 @@
 #include "doc/frame.h"
 
 namespace doc {
+  class Cel;
   class Layer;
+  class Mask;
 }
 
 namespace app {
@@ -20,6 +23,10 @@ namespace app {
     REPLACE, ADD, SUBTRACT, INTERSECT
   };
 
+  // Creates a mask with the opaque pixels of the given cel (or with
+  // the whole cel bounds in case of tilemaps).
+  void mask_from_cel(const doc::Cel* cel, doc::Mask& newMask);
+
   void select_layer_boundaries(doc::Layer* layer,
                                const doc::frame_t frame,
                                const SelectLayerBoundariesOp op);
@@ -0,0 +1,178 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/util/layer_boundaries.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+color_t opaque_color(PixelFormat pf)
+{
+  switch (pf) {
+    case IMAGE_RGB: return rgba(255, 0, 0, 255);
+    case IMAGE_GRAYSCALE: return graya(128, 255);
+    default: return 1;
+  }
+}
+
+color_t transparent_color(PixelFormat pf)
+{
+  switch (pf) {
+    case IMAGE_RGB: return rgba(255, 0, 0, 127);
+    case IMAGE_GRAYSCALE: return graya(128, 127);
+    default: return 0;
+  }
+}
+
+bool is_opaque(PixelFormat pf, color_t c)
+{
+  switch (pf) {
+    case IMAGE_RGB: return rgba_geta(c) >= 128;
+    case IMAGE_GRAYSCALE: return graya_geta(c) >= 128;
+    default: return c != 0;
+  }
+}
+
+// Compares the mask generated by mask_from_cel() with the opaque
+// pixels of the cel checking pixel by pixel.
+void expect_mask_from_opaque_pixels(const Cel* cel)
+{
+  const Image* image = cel->image();
+  const PixelFormat pf = image->pixelFormat();
+  const gfx::Point pos = cel->position();
+
+  Mask mask;
+  mask_from_cel(cel, mask);
+
+  gfx::Rect opaqueBounds;
+  for (int y=0; y<image->height(); ++y) {
+    for (int x=0; x<image->width(); ++x) {
+      const bool opaque = is_opaque(pf, get_pixel(image, x, y));
+      ASSERT_EQ(opaque, mask.containsPoint(pos.x+x, pos.y+y))
+        << "pixelFormat=" << pf
+        << " size=" << image->width() << "x" << image->height()
+        << " x=" << x << " y=" << y;
+      if (opaque)
+        opaqueBounds |= gfx::Rect(pos.x+x, pos.y+y, 1, 1);
+    }
+  }
+  EXPECT_EQ(opaqueBounds, mask.bounds());
+}
+
+const PixelFormat kPixelFormats[] = {
+  IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED
+};
+
+} // anonymous namespace
+
+TEST(LayerBoundaries, FullAndEmptyRows)
+{
+  for (PixelFormat pf : kPixelFormats) {
+    for (int w : { 1, 7, 8, 16, 17 }) {
+      ImageRef image(Image::create(pf, w, 4));
+      clear_image(image.get(), transparent_color(pf));
+      // Rows 1 and 3 are full, rows 0 and 2 are empty
+      fill_rect(image.get(), 0, 1, w-1, 1, opaque_color(pf));
+      fill_rect(image.get(), 0, 3, w-1, 3, opaque_color(pf));
+
+      Cel cel(0, image);
+      cel.setPosition(3, -2);
+      expect_mask_from_opaque_pixels(&cel);
+    }
+
+    // Completely transparent image
+    ImageRef image(Image::create(pf, 19, 5));
+    clear_image(image.get(), transparent_color(pf));
+    Cel cel(0, image);
+    Mask mask;
+    mask_from_cel(&cel, mask);
+    EXPECT_TRUE(mask.isEmpty());
+  }
+}
+
+TEST(LayerBoundaries, PartialLastWord)
+{
+  // Widths that aren't multiple of the pixels per 64-bit word (2 RGB,
+  // 4 grayscale, 8 indexed pixels), with opaque pixels only in the
+  // last partial word.
+  for (PixelFormat pf : kPixelFormats) {
+    for (int w : { 3, 5, 9, 11, 13, 23 }) {
+      ImageRef image(Image::create(pf, w, 3));
+      clear_image(image.get(), transparent_color(pf));
+      put_pixel(image.get(), w-1, 0, opaque_color(pf));
+      fill_rect(image.get(), w-2, 2, w-1, 2, opaque_color(pf));
+
+      Cel cel(0, image);
+      expect_mask_from_opaque_pixels(&cel);
+    }
+  }
+}
+
+TEST(LayerBoundaries, RunsCrossingWords)
+{
+  for (PixelFormat pf : kPixelFormats) {
+    ImageRef image(Image::create(pf, 37, 4));
+    clear_image(image.get(), transparent_color(pf));
+    fill_rect(image.get(), 1, 0, 2, 0, opaque_color(pf));   // RGB word boundary
+    fill_rect(image.get(), 3, 1, 17, 1, opaque_color(pf));  // Several words
+    fill_rect(image.get(), 7, 2, 8, 2, opaque_color(pf));   // Indexed word boundary
+    fill_rect(image.get(), 15, 3, 36, 3, opaque_color(pf)); // Until the end
+
+    Cel cel(0, image);
+    cel.setPosition(-5, 10);
+    expect_mask_from_opaque_pixels(&cel);
+  }
+}
+
+TEST(LayerBoundaries, RandomImages)
+{
+  std::srand(1);
+  for (PixelFormat pf : kPixelFormats) {
+    for (int w=1; w<40; w+=3) {
+      ImageRef image(Image::create(pf, w, 7));
+      for (int y=0; y<image->height(); ++y) {
+        // Long runs of opaque/transparent pixels
+        bool opaque = (std::rand() & 1);
+        for (int x=0; x<w; ++x) {
+          if ((std::rand() % 6) == 0)
+            opaque = !opaque;
+          put_pixel(image.get(), x, y,
+                    opaque ? opaque_color(pf): transparent_color(pf));
+        }
+      }
+
+      Cel cel(0, image);
+      cel.setPosition(w, -w);
+      expect_mask_from_opaque_pixels(&cel);
+    }
+  }
+}
+
+TEST(LayerBoundaries, TilemapSelectsWholeCel)
+{
+  ImageRef image(Image::create(IMAGE_TILEMAP, 4, 3));
+  clear_image(image.get(), 0);
+
+  Cel cel(0, image);
+  cel.setBounds(gfx::Rect(8, 4, 64, 48));
+
+  Mask mask;
+  mask_from_cel(&cel, mask);
+  EXPECT_EQ(gfx::Rect(8, 4, 64, 48), mask.bounds());
+  EXPECT_TRUE(mask.containsPoint(8, 4));
+  EXPECT_TRUE(mask.containsPoint(71, 51));
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021 Igara Studio S.A.
+// Copyright (C) 2019-2024 Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -13,16 +13,106 @@
 
 #include "app/doc.h"
 #include "app/site.h"
+#include "doc/algorithm/mask_runs.h"
+#include "doc/dispatch.h"
 #include "doc/image_impl.h"
 #include "doc/layer.h"
 #include "doc/mask.h"
 #include "doc/primitives.h"
 #include "render/render.h"
 
+#include <algorithm>
+
 namespace app {
 
 using namespace doc;
 
+namespace {
+
+// Copies the selected pixels from "src" (located at "srcPos" in the
+// canvas) to "dst" (located at "maskBounds.origin()").
+template<typename ImageTraits>
+void copy_masked_pixels_templ(Image* dst,
+                              const Image* src,
+                              const gfx::Point& srcPos,
+                              const Image* maskBitmap,
+                              const gfx::Rect& maskBounds)
+{
+  using address_t = typename ImageTraits::address_t;
+  using const_address_t = typename ImageTraits::const_address_t;
+
+  // Only the area where the mask and the source image intersect
+  const gfx::Rect area =
+    maskBounds & gfx::Rect(srcPos, src->size());
+  if (area.isEmpty())
+    return;
+
+  const int u0 = area.x - maskBounds.x;
+  const int v0 = area.y - maskBounds.y;
+  const int sx = area.x - srcPos.x;
+  const int sy = area.y - srcPos.y;
+
+  for (int v=0; v<area.h; ++v) {
+    const uint8_t* maskRow = maskBitmap->getPixelAddress(0, v0+v);
+    auto dstRow = (address_t)dst->getPixelAddress(0, v0+v);
+    auto srcRow = (const_address_t)src->getPixelAddress(0, sy+v);
+
+    doc::algorithm::for_each_mask_run(
+      maskRow, maskBounds.w, true,
+      [&](int u1, int u2) {
+        u1 = std::max(u1, u0);
+        u2 = std::min(u2, u0+area.w);
+        if (u1 < u2)
+          std::copy(srcRow+sx+u1-u0, srcRow+sx+u2-u0, dstRow+u1);
+      });
+  }
+}
+
+// Clears the unselected pixels of "dst" (which has the size of the
+// mask bounds).
+template<typename ImageTraits>
+void clear_unmasked_pixels_templ(Image* dst,
+                                 const Image* maskBitmap)
+{
+  using address_t = typename ImageTraits::address_t;
+  const color_t maskColor = dst->maskColor();
+
+  for (int v=0; v<dst->height(); ++v) {
+    const uint8_t* maskRow = maskBitmap->getPixelAddress(0, v);
+    auto dstRow = (address_t)dst->getPixelAddress(0, v);
+
+    doc::algorithm::for_each_mask_run(
+      maskRow, dst->width(), false,
+      [&](int u1, int u2) {
+        std::fill(dstRow+u1, dstRow+u2, maskColor);
+      });
+  }
+}
+
+} // anonymous namespace
+
+void copy_masked_pixels(Image* dst,
+                        const Image* src,
+                        const gfx::Point& srcPos,
+                        const Image* maskBitmap,
+                        const gfx::Rect& maskBounds)
+{
+  ASSERT(dst->pixelFormat() == src->pixelFormat());
+  DOC_DISPATCH_BY_COLOR_MODE_EXCLUDE_BITMAP(
+    dst->colorMode(),
+    copy_masked_pixels_templ,
+    dst, src, srcPos, maskBitmap, maskBounds);
+}
+
+void clear_unmasked_pixels(Image* dst,
+                           const Image* maskBitmap)
+{
+  DOC_DISPATCH_BY_COLOR_MODE_EXCLUDE_BITMAP(
+    dst->colorMode(),
+    clear_unmasked_pixels_templ,
+    dst, maskBitmap);
+}
+
 Image* new_image_from_mask(const Site& site, const bool newBlend)
 {
   const Mask* srcMask = site.document()->mask();
@@ -82,31 +172,14 @@ doc::Image* new_image_from_mask(const Site& site,
   // Copy the masked zones
   if (src) {
     if (srcMaskBitmap) {
-      // Copy active layer with mask
-      const LockImageBits<BitmapTraits> maskBits(srcMaskBitmap, gfx::Rect(0, 0, srcBounds.w, srcBounds.h));
-      LockImageBits<BitmapTraits>::const_iterator mask_it = maskBits.begin();
-
-      for (int v=0; v<srcBounds.h; ++v) {
-        for (int u=0; u<srcBounds.w; ++u, ++mask_it) {
-          ASSERT(mask_it != maskBits.end());
-
-          if (src != dst.get()) {
-            if (*mask_it) {
-              int getx = u+srcBounds.x-x;
-              int gety = v+srcBounds.y-y;
-
-              if ((getx >= 0) && (getx < src->width()) &&
-                  (gety >= 0) && (gety < src->height()))
-                dst->putPixel(u, v, src->getPixel(getx, gety));
-            }
-          }
-          else {
-            if (!*mask_it) {
-              dst->putPixel(u, v, dst->maskColor());
-            }
-          }
-        }
-      }
+      // Copy active layer with mask (only the intersection between
+      // the mask and the source image is visited)
+      if (src != dst.get())
+        copy_masked_pixels(dst.get(), src, gfx::Point(x, y),
+                           srcMaskBitmap, srcBounds);
+      // Clear the unselected pixels of the rendered area
+      else
+        clear_unmasked_pixels(dst.get(), srcMaskBitmap);
     }
     else if (src != dst.get()) {
       copy_image(dst.get(), src, -srcBounds.x, -srcBounds.y);
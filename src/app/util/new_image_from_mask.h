@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020 Igara Studio S.A.
+// Copyright (C) 2019-2024 Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -9,6 +9,8 @@
 #define APP_UTIL_NEW_IMAGE_FROM_MASK_H_INCLUDED
 #pragma once
 
+#include "gfx/fwd.h"
+
 namespace doc {
   class Image;
   class Mask;
@@ -26,6 +28,21 @@ namespace app {
   doc::Image* new_tilemap_from_mask(const Site& site,
                                     const doc::Mask* mask);
 
+  // Copies the selected pixels from "src" (located at "srcPos" in
+  // the canvas) to "dst" (located at "maskBounds.origin()"). Only
+  // the area where the mask and the source image intersect is
+  // copied.
+  void copy_masked_pixels(doc::Image* dst,
+                          const doc::Image* src,
+                          const gfx::Point& srcPos,
+                          const doc::Image* maskBitmap,
+                          const gfx::Rect& maskBounds);
+
+  // Clears the unselected pixels of "dst" (which has the size of the
+  // mask bounds) with its mask color.
+  void clear_unmasked_pixels(doc::Image* dst,
+                             const doc::Image* maskBitmap);
+
 } // namespace app
 
 #endif
@@ -0,0 +1,74 @@
+// Aseprite
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/util/new_image_from_mask.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+
+using namespace app;
+using namespace doc;
+
+TEST(NewImageFromMask, CopyMaskedPixelsIntersection)
+{
+  std::srand(1);
+
+  // Non-rectangular selection: a rectangle with a hole and a
+  // removed corner
+  Mask mask;
+  mask.replace(gfx::Rect(3, 2, 21, 9));
+  mask.subtract(gfx::Rect(8, 4, 5, 3));
+  mask.subtract(gfx::Rect(3, 2, 4, 2));
+  const gfx::Rect bounds = mask.bounds();
+
+  for (PixelFormat pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    ImageRef src(Image::create(pf, 11, 6));
+    for (int y=0; y<src->height(); ++y)
+      for (int x=0; x<src->width(); ++x)
+        put_pixel(src.get(), x, y, 1 + (std::rand() % 200));
+
+    // Source images completely inside, partially overlapping (on each
+    // side) and outside the selection
+    for (const gfx::Point srcPos : { gfx::Point(6, 3),
+                                     gfx::Point(-4, 0),
+                                     gfx::Point(18, 7),
+                                     gfx::Point(10, -3),
+                                     gfx::Point(0, 9),
+                                     gfx::Point(40, 40) }) {
+      const color_t sentinel = 255;
+      ImageRef dst(Image::create(pf, bounds.w, bounds.h));
+      clear_image(dst.get(), sentinel);
+
+      copy_masked_pixels(dst.get(), src.get(), srcPos,
+                         mask.bitmap(), bounds);
+      clear_unmasked_pixels(dst.get(), mask.bitmap());
+
+      for (int v=0; v<bounds.h; ++v) {
+        for (int u=0; u<bounds.w; ++u) {
+          const gfx::Point pt(bounds.x+u, bounds.y+v);
+          const gfx::Point srcPt = pt - srcPos;
+          color_t expected;
+          if (!mask.containsPoint(pt.x, pt.y))
+            expected = dst->maskColor();
+          else if (src->bounds().contains(srcPt))
+            expected = get_pixel(src.get(), srcPt.x, srcPt.y);
+          else
+            expected = sentinel;
+
+          ASSERT_EQ(expected, get_pixel(dst.get(), u, v))
+            << "pixelFormat=" << pf
+            << " srcPos=" << srcPos.x << "," << srcPos.y
+            << " u=" << u << " v=" << v;
+        }
+      }
+    }
+  }
+}
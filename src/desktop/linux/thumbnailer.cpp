@@ -0,0 +1,257 @@
+// Desktop Integration
+// Copyright (c) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+// Thumbnailer for file managers (GNOME, KDE, etc.). It decodes only
+// the first frame of .aseprite files with the dio library and renders
+// it, without launching the whole Aseprite app. Other file formats
+// are delegated to "aseprite -b".
+
+#include "base/file_handle.h"
+#include "base/fs.h"
+#include "dio/decode_delegate.h"
+#include "dio/decode_file.h"
+#include "dio/file_interface.h"
+#include "doc/image_ref.h"
+#include "doc/sprite.h"
+#include "render/render.h"
+
+#include "png.h"
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+extern char** environ;
+
+namespace desktop {
+
+namespace {
+
+class DecodeDelegate : public dio::DecodeDelegate {
+public:
+  DecodeDelegate() : m_sprite(nullptr) { }
+  ~DecodeDelegate() { delete m_sprite; }
+
+  bool decodeOneFrame() override { return true; }
+  bool shareReferencedImages() const override { return true; }
+  void onSprite(doc::Sprite* sprite) override {
+    m_sprite = sprite;
+  }
+
+  doc::Sprite* sprite() { return m_sprite; }
+
+private:
+  doc::Sprite* m_sprite;
+};
+
+// Renders the first frame of the sprite scaled down to fit in a
+// size x size square (or in its original size if size = 0).
+doc::ImageRef render_thumbnail(const doc::Sprite* spr, const int size)
+{
+  const int w = spr->width();
+  const int h = spr->height();
+  const int wh = std::max<int>(w, h);
+  const int cx = (size > 0 ? std::min<int>(size, wh): wh);
+
+  doc::ImageRef image(doc::Image::create(doc::IMAGE_RGB,
+                                         std::max(1, cx * w / wh),
+                                         std::max(1, cx * h / wh)));
+  image->clear(0);
+
+  render::Render render;
+  render.setBgOptions(render::BgOptions::MakeTransparent());
+  render.setProjection(render::Projection(doc::PixelRatio(1, 1),
+                                          render::Zoom(cx, wh)));
+  render.renderSprite(image.get(), spr, 0,
+                      gfx::ClipF(0, 0, 0, 0,
+                                 image->width(), image->height()));
+  return image;
+}
+
+bool write_png(const std::string& filename, const doc::Image* image)
+{
+  base::FileHandle handle(base::open_file(filename, "wb"));
+  FILE* fp = handle.get();
+  if (!fp)
+    return false;
+
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+                                            nullptr, nullptr, nullptr);
+  if (!png)
+    return false;
+
+  png_infop info = png_create_info_struct(png);
+  const int w = image->width();
+  const int h = image->height();
+  std::vector<uint8_t> row(4*w);
+
+  if (!info || setjmp(png_jmpbuf(png))) {
+    png_destroy_write_struct(&png, &info);
+    return false;
+  }
+
+  png_init_io(png, fp);
+  png_set_compression_level(png, 1);
+  png_set_IHDR(png, info, w, h, 8,
+               PNG_COLOR_TYPE_RGB_ALPHA,
+               PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT,
+               PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+
+  for (int y=0; y<h; ++y) {
+    auto src = (const doc::RgbTraits::pixel_t*)image->getPixelAddress(0, y);
+    uint8_t* dst = &row[0];
+    for (int x=0; x<w; ++x, ++src) {
+      *(dst++) = doc::rgba_getr(*src);
+      *(dst++) = doc::rgba_getg(*src);
+      *(dst++) = doc::rgba_getb(*src);
+      *(dst++) = doc::rgba_geta(*src);
+    }
+    png_write_row(png, &row[0]);
+  }
+
+  png_write_end(png, info);
+  png_destroy_write_struct(&png, &info);
+  return true;
+}
+
+// Uses the Aseprite CLI to create the thumbnail of files that cannot
+// be decoded with the dio library (PNG, GIF, FLI, etc.)
+bool make_thumbnail_with_app(const std::string& input,
+                             const std::string& output,
+                             const int size)
+{
+  // Avoid parsing the filename as a CLI option
+  if (input.empty() || input[0] == '-') {
+    std::fprintf(stderr, "Invalid input file %s\n", input.c_str());
+    return false;
+  }
+
+  // The output file can be an extensionless temporary file (e.g. in
+  // KDE), so the CLI cannot know the format of the output. We save a
+  // temporary .png file in the same directory (so we can rename it).
+  std::string outputDir = base::get_file_path(output);
+  if (outputDir.empty())
+    outputDir = ".";
+  std::string tmpOutput =
+    base::join_path(outputDir, "aseprite-thumbnail-XXXXXX.png");
+  const int fd = mkstemps(tmpOutput.data(), 4);
+  if (fd < 0)
+    return false;
+  close(fd);
+
+  std::vector<std::string> args = {
+    "aseprite", "-b", "--frame-range", "0,0", input
+  };
+  if (size > 0) {
+    args.push_back("--shrink-to");
+    args.push_back(std::to_string(size) + "," + std::to_string(size));
+  }
+  args.push_back("--sheet");
+  args.push_back(tmpOutput);
+
+  std::vector<char*> argv;
+  for (auto& arg : args)
+    argv.push_back(arg.data());
+  argv.push_back(nullptr);
+
+  pid_t pid;
+  int status;
+  if (posix_spawnp(&pid, argv[0], nullptr, nullptr,
+                   argv.data(), environ) == 0 &&
+      waitpid(pid, &status, 0) == pid &&
+      WIFEXITED(status) &&
+      WEXITSTATUS(status) == 0 &&
+      base::file_size(tmpOutput) > 0 &&
+      std::rename(tmpOutput.c_str(), output.c_str()) == 0) {
+    return true;
+  }
+
+  std::remove(tmpOutput.c_str());
+  return false;
+}
+
+bool make_thumbnail(const std::string& input,
+                    const std::string& output,
+                    const int size)
+{
+  const std::string outputDir = base::get_file_path(output);
+  if (!outputDir.empty() && !base::is_directory(outputDir))
+    base::make_all_directories(outputDir);
+
+  try {
+    base::FileHandle handle(base::open_file(input, "rb"));
+    if (!handle) {
+      std::fprintf(stderr, "Cannot open file %s\n", input.c_str());
+      return false;
+    }
+
+    DecodeDelegate delegate;
+    dio::StdioFileInterface f(handle.get());
+    if (dio::decode_file(&delegate, &f) && delegate.sprite()) {
+      doc::ImageRef image = render_thumbnail(delegate.sprite(), size);
+      return write_png(output, image.get());
+    }
+  }
+  catch (const std::exception& e) {
+    std::fprintf(stderr, "Error creating thumbnail of %s: %s\n",
+                 input.c_str(), e.what());
+    return false;
+  }
+
+  return make_thumbnail_with_app(input, output, size);
+}
+
+void show_usage()
+{
+  std::fprintf(
+    stderr,
+    "Usage:\n"
+    "  aseprite-thumbnailer inputfile outputfile [size]\n"
+    "  aseprite-thumbnailer --size N input1 output1 [input2 output2 ...]\n");
+}
+
+} // anonymous namespace
+
+} // namespace desktop
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> args(argv+1, argv+argc);
+  int size = 0;
+
+  // Batch mode to create several thumbnails in the same process
+  if (args.size() >= 2 &&
+      (args[0] == "-s" || args[0] == "--size")) {
+    size = std::atoi(args[1].c_str());
+    args.erase(args.begin(), args.begin()+2);
+  }
+  // Compatible with the thumbnailer entry (Exec=... %i %o %s)
+  else if (args.size() == 3) {
+    size = std::atoi(args[2].c_str());
+    args.pop_back();
+  }
+
+  if (args.empty() || (args.size() & 1) || size < 0) {
+    desktop::show_usage();
+    return EXIT_FAILURE;
+  }
+
+  int failures = 0;
+  for (size_t i=0; i<args.size(); i+=2) {
+    if (!desktop::make_thumbnail(args[i], args[i+1], size))
+      ++failures;
+  }
+  return (failures == 0 ? EXIT_SUCCESS: EXIT_FAILURE);
+}
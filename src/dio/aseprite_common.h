@@ -43,6 +43,7 @@
 #define ASE_FILE_LINK_CEL                   1
 #define ASE_FILE_COMPRESSED_CEL             2
 #define ASE_FILE_COMPRESSED_TILEMAP         3
+#define ASE_FILE_IMAGE_REF_CEL              4
 
 #define ASE_FILE_NO_COLOR_PROFILE           0
 #define ASE_FILE_SRGB_COLOR_PROFILE         1
@@ -55,6 +56,7 @@
 #define ASE_USER_DATA_FLAG_HAS_TEXT         1
 #define ASE_USER_DATA_FLAG_HAS_COLOR        2
 #define ASE_USER_DATA_FLAG_HAS_PROPERTIES   4
+#define ASE_USER_DATA_FLAG_SAME_AS_TILE     8
 
 #define ASE_CEL_EXTRA_FLAG_PRECISE_BOUNDS   1
 
@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2024 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -28,10 +28,25 @@
 #include "zlib.h"
 
 #include <cstdio>
+#include <string>
 #include <vector>
 
 namespace dio {
 
+// Max size of a block of properties to compare it with other blocks
+// (bigger blocks are not shared between objects)
+const size_t kMaxSharedPropertiesSize = 64*1024;
+
+// Size of each block of compressed data read from the file to
+// inflate cel images.
+const size_t kCompressedBlockSize = 64*1024;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+constexpr bool kBigEndian = true;
+#else
+constexpr bool kBigEndian = false;
+#endif
+
 bool AsepriteDecoder::decode()
 {
   bool ignore_old_color_chunks = false;
@@ -98,8 +113,17 @@ bool AsepriteDecoder::decode()
   if (nframes > 1 && delegate()->decodeOneFrame())
     nframes = 1;
 
+  // Pointer to the sprite that is valid even when the ownership is
+  // given to the delegate after the first frame (decodeProgressively())
+  doc::Sprite* spr = sprite.get();
+
   // Read frame by frame to end-of-file
   for (doc::frame_t frame=0; frame<nframes; ++frame) {
+    // The sprite is owned by the delegate, notify it before we modify
+    // the sprite
+    if (!sprite)
+      delegate()->onBeginFrame(frame);
+
     // Start frame position
     size_t frame_pos = f()->tell();
     delegate()->progress((float)frame_pos / (float)header.size);
@@ -112,7 +136,7 @@ bool AsepriteDecoder::decode()
     if (frame_header.magic == ASE_FILE_FRAME_MAGIC) {
       // Use frame-duration field?
       if (frame_header.duration > 0)
-        sprite->setFrameDuration(frame, frame_header.duration);
+        spr->setFrameDuration(frame, frame_header.duration);
 
       // Read chunks
       for (uint32_t c=0; c<frame_header.chunks; c++) {
@@ -129,24 +153,24 @@ bool AsepriteDecoder::decode()
           case ASE_FILE_CHUNK_FLI_COLOR:
           case ASE_FILE_CHUNK_FLI_COLOR2:
             if (!ignore_old_color_chunks) {
-              doc::Palette* prevPal = sprite->palette(frame);
+              doc::Palette* prevPal = spr->palette(frame);
               std::unique_ptr<doc::Palette> pal(
                 chunk_type == ASE_FILE_CHUNK_FLI_COLOR ?
                 readColorChunk(prevPal, frame):
                 readColor2Chunk(prevPal, frame));
 
               if (prevPal->countDiff(pal.get(), NULL, NULL) > 0)
-                sprite->setPalette(pal.get(), true);
+                spr->setPalette(pal.get(), true);
             }
             break;
 
           case ASE_FILE_CHUNK_PALETTE: {
-            doc::Palette* prevPal = sprite->palette(frame);
+            doc::Palette* prevPal = spr->palette(frame);
             std::unique_ptr<doc::Palette> pal(
               readPaletteChunk(prevPal, frame));
 
             if (prevPal->countDiff(pal.get(), NULL, NULL) > 0)
-              sprite->setPalette(pal.get(), true);
+              spr->setPalette(pal.get(), true);
 
             ignore_old_color_chunks = true;
             break;
@@ -154,7 +178,7 @@ bool AsepriteDecoder::decode()
 
           case ASE_FILE_CHUNK_LAYER: {
             doc::Layer* newLayer =
-              readLayerChunk(&header, sprite.get(),
+              readLayerChunk(&header, spr,
                              &last_layer,
                              &current_level);
             if (newLayer) {
@@ -171,8 +195,8 @@ bool AsepriteDecoder::decode()
 
           case ASE_FILE_CHUNK_CEL: {
             doc::Cel* cel =
-              readCelChunk(sprite.get(), frame,
-                           sprite->pixelFormat(), &header,
+              readCelChunk(spr, frame,
+                           spr->pixelFormat(), &header,
                            chunk_pos+chunk_size);
             if (cel) {
               last_cel = cel;
@@ -191,7 +215,7 @@ bool AsepriteDecoder::decode()
           }
 
           case ASE_FILE_CHUNK_COLOR_PROFILE: {
-            readColorProfile(sprite.get());
+            readColorProfile(spr);
             break;
           }
 
@@ -202,7 +226,7 @@ bool AsepriteDecoder::decode()
             if (!extFiles.empty()) {
               std::string fn = extFiles.tileManagementPlugin();
               if (!fn.empty())
-                sprite->setTileManagementPlugin(fn);
+                spr->setTileManagementPlugin(fn);
             }
             break;
 
@@ -220,9 +244,9 @@ bool AsepriteDecoder::decode()
             break;
 
           case ASE_FILE_CHUNK_TAGS:
-            readTagsChunk(&sprite->tags());
-            tag_it = sprite->tags().begin();
-            tag_end = sprite->tags().end();
+            readTagsChunk(&spr->tags());
+            tag_it = spr->tags().begin();
+            tag_end = spr->tags().end();
 
             if (tag_it != tag_end)
               last_object_with_user_data = *tag_it;
@@ -231,12 +255,12 @@ bool AsepriteDecoder::decode()
             break;
 
           case ASE_FILE_CHUNK_SLICES: {
-            readSlicesChunk(sprite->slices());
+            readSlicesChunk(spr->slices());
             break;
           }
 
           case ASE_FILE_CHUNK_SLICE: {
-            doc::Slice* slice = readSliceChunk(sprite->slices());
+            doc::Slice* slice = readSliceChunk(spr->slices());
             if (slice)
               last_object_with_user_data = slice;
             break;
@@ -286,7 +310,7 @@ bool AsepriteDecoder::decode()
           }
 
           case ASE_FILE_CHUNK_TILESET: {
-            doc::Tileset* tileset = readTilesetChunk(sprite.get(), &header, extFiles);
+            doc::Tileset* tileset = readTilesetChunk(spr, &header, extFiles);
             if (tileset)
               last_object_with_user_data = tileset;
             break;
@@ -306,11 +330,19 @@ bool AsepriteDecoder::decode()
     // Skip frame size
     f()->seek(frame_pos+frame_header.size);
 
+    if (!sprite)
+      delegate()->onEndFrame(frame);
+    // Give the sprite to the delegate with its first frame, so it can
+    // be used while the rest of frames are decoded
+    else if (nframes > 1 && delegate()->decodeProgressively())
+      delegate()->onSprite(sprite.release());
+
     if (delegate()->isCanceled())
       break;
   }
 
-  delegate()->onSprite(sprite.release());
+  if (sprite)
+    delegate()->onSprite(sprite.release());
   return true;
 }
 
@@ -718,14 +750,19 @@ void read_compressed_image_templ(FileInterface* f,
     throw base::Exception("ZLib error %d in inflateInit().", err);
 
   const int width = image->width();
+  const int height = image->height();
   const int widthBytes = image->widthBytes();
-  std::vector<uint8_t> scanline(widthBytes);
-  std::vector<uint8_t> compressed(4096);
-  std::vector<uint8_t> uncompressed(4096);
-  int scanline_offset = 0;
+  std::vector<uint8_t> compressed(kCompressedBlockSize);
   int y = 0;
 
-  while (true) {
+  // Pixels are inflated directly in the memory of each image row
+  // (which has the same layout as the file on little-endian hosts).
+  if (height > 0) {
+    zstream.next_out = (Bytef*)image->getPixelAddress(0, 0);
+    zstream.avail_out = widthBytes;
+  }
+
+  while (y < height && err != Z_STREAM_END) {
     size_t input_bytes;
 
     if (f->tell()+compressed.size() > chunk_end) {
@@ -754,44 +791,27 @@ void read_compressed_image_templ(FileInterface* f,
     zstream.avail_in = bytes_read;
 
     do {
-      zstream.next_out = (Bytef*)&uncompressed[0];
-      zstream.avail_out = uncompressed.size();
-
       err = inflate(&zstream, Z_NO_FLUSH);
       if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
         throw base::Exception("ZLib error %d in inflate().", err);
 
-      size_t uncompressed_bytes = uncompressed.size() - zstream.avail_out;
-      if (uncompressed_bytes > 0) {
-        int i = 0;
-        while (y < image->height()) {
-          int n = std::min(uncompressed_bytes, scanline.size() - scanline_offset);
-          if (n > 0) {
-            // Fill the scanline buffer until it's completed
-            std::copy(uncompressed.begin()+i,
-                      uncompressed.begin()+i+n,
-                      scanline.begin()+scanline_offset);
-            uncompressed_bytes -= n;
-            scanline_offset += n;
-            i += n;
-          }
-          else if (scanline_offset < widthBytes) {
-            // The scanline is not filled yet.
-            break;
-          }
-          else {
-            // Copy the whole scanline to the image
-            pixel_io.read_scanline(
-              (typename ImageTraits::address_t)image->getPixelAddress(0, y),
-              width, &scanline[0]);
-            ++y;
-            scanline_offset = 0;
-            if (uncompressed_bytes == 0)
-              break;
-          }
+      if (zstream.avail_out == 0) {
+        // The row is completed, convert it in-place if the file
+        // layout doesn't match the image layout.
+        if constexpr (kBigEndian && ImageTraits::bytes_per_pixel > 1) {
+          auto address = image->getPixelAddress(0, y);
+          pixel_io.read_scanline(
+            (typename ImageTraits::address_t)address,
+            width, address);
         }
+
+        if (++y == height)
+          break;
+
+        zstream.next_out = (Bytef*)image->getPixelAddress(0, y);
+        zstream.avail_out = widthBytes;
       }
-    } while (zstream.avail_in != 0 && zstream.avail_out == 0);
+    } while (zstream.avail_in != 0 && err == Z_OK);
 
     delegate->progress((float)f->tell() / (float)header->size);
   }
@@ -943,6 +963,39 @@ doc::Cel* AsepriteDecoder::readCelChunk(doc::Sprite* sprite,
       break;
     }
 
+    case ASE_FILE_IMAGE_REF_CEL: {
+      // Read the position of the cel with the same image
+      doc::layer_t ref_layer_index = read16();
+      doc::frame_t ref_frame = doc::frame_t(read16());
+
+      doc::Layer* ref_layer = nullptr;
+      if (ref_layer_index >= 0 && ref_layer_index < doc::layer_t(m_allLayers.size()))
+        ref_layer = m_allLayers[ref_layer_index];
+
+      doc::Cel* ref = (ref_layer && ref_layer->isImage() ?
+                       ref_layer->cel(ref_frame): nullptr);
+      if (!ref ||
+          layer->isTilemap() ||
+          ref->image()->pixelFormat() != pixelFormat) {
+        delegate()->error(
+          fmt::format("Frame {0} didn't found the referenced image in layer {1} frame {2}",
+                      (int)frame, (int)ref_layer_index, (int)ref_frame));
+        return nullptr;
+      }
+
+      doc::ImageRef image;
+      if (delegate()->shareReferencedImages())
+        image = ref->imageRef();
+      else
+        image.reset(doc::Image::createCopy(ref->image()));
+
+      cel = std::make_unique<doc::Cel>(frame, image);
+      cel->setPosition(x, y);
+      cel->setOpacity(opacity);
+      cel->setZIndex(zIndex);
+      break;
+    }
+
     case ASE_FILE_COMPRESSED_TILEMAP: {
       // Read width and height
       int w = read16();
@@ -1204,7 +1257,33 @@ void AsepriteDecoder::readUserDataChunk(doc::UserData* userData,
   }
 
   if (flags & ASE_USER_DATA_FLAG_HAS_PROPERTIES) {
+    // Several objects (e.g. all tiles of a tileset) can have exactly
+    // the same properties, so we compare the raw bytes of this block
+    // of properties with the ones already read to share them.
+    const size_t startPos = f()->tell();
+    const size_t size = read32();
+    std::string raw;
+    if (size > 4 && size < kMaxSharedPropertiesSize) {
+      raw.resize(size);
+      f()->seek(startPos);
+      if (f()->readBytes((uint8_t*)&raw[0], size) != size)
+        raw.clear();
+    }
+    f()->seek(startPos);
+
+    if (!raw.empty()) {
+      auto it = m_propertiesMaps.find(raw);
+      if (it != m_propertiesMaps.end()) {
+        userData->setPropertiesMapsRef(it->second);
+        f()->seek(startPos+size);
+        return;
+      }
+    }
+
     readPropertiesMaps(userData->propertiesMaps(), extFiles);
+
+    if (!raw.empty())
+      m_propertiesMaps[raw] = userData->propertiesMapsRef();
   }
 }
 
@@ -1517,6 +1596,22 @@ void AsepriteDecoder::readTilesData(doc::Tileset* tileset, const AsepriteExterna
       return;
     }
 
+    // Same user data as a previous tile (the properties are shared
+    // between both tiles until one of them is modified)
+    const size_t data_pos = f()->tell();
+    if (read32() & ASE_USER_DATA_FLAG_SAME_AS_TILE) {
+      const doc::tile_index ti = read32();
+      if (ti < i)
+        tileset->setTileData(i, tileset->getTileData(ti));
+      else
+        delegate()->error(
+          fmt::format("Error: Invalid tile reference {0} in user data of tile {1}",
+                      ti, i));
+      f()->seek(chunk_pos+chunk_size);
+      continue;
+    }
+    f()->seek(data_pos);
+
     doc::UserData tileData;
     readUserDataChunk(&tileData, extFiles);
     tileset->setTileData(i, tileData);
@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2024 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -19,6 +19,7 @@
 #include "doc/user_data.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace doc {
@@ -76,6 +77,10 @@ private:
 
   doc::LayerList m_allLayers;
   std::vector<uint32_t> m_tilesetFlags;
+
+  // Properties maps already read in this file indexed by their raw
+  // bytes, to share identical sets of properties between objects.
+  std::unordered_map<std::string, doc::UserData::PropertiesMapsRef> m_propertiesMaps;
 };
 
 } // namespace dio
@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2023 Igara Studio S.A.
+// Copyright (c) 2023-2024 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -38,6 +38,15 @@ public:
   // to generate a thumbnail)
   virtual bool decodeOneFrame() { return false; }
 
+  // Return true if you want to receive the sprite in onSprite() as
+  // soon as its first frame is decoded (e.g. to display it while the
+  // rest of frames are loaded). In this case the rest of frames are
+  // decoded directly in the given sprite, and each frame is enclosed
+  // between onBeginFrame()/onEndFrame() calls.
+  virtual bool decodeProgressively() { return false; }
+  virtual void onBeginFrame(doc::frame_t frame) { }
+  virtual void onEndFrame(doc::frame_t frame) { }
+
   // Default color for slices without user data
   virtual doc::color_t defaultSliceColor() {
     return doc::rgba(0, 0, 255, 255);
@@ -56,6 +65,15 @@ public:
   virtual bool cacheCompressedTilesets() const {
     return false;
   }
+
+  // Returns true if cels that reference the image of other cel
+  // (ASE_FILE_IMAGE_REF_CEL) should share the same doc::Image in
+  // memory instead of creating a copy. Shared images must be used
+  // as read-only (e.g. to export the sprite from the CLI), because
+  // modifying the pixels of one cel will modify the other cels too.
+  virtual bool shareReferencedImages() const {
+    return false;
+  }
 };
 
 } // namespace dio
@@ -0,0 +1,106 @@
+// Aseprite Document Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/algorithm/color_rects.h"
+
+#include "doc/dispatch.h"
+#include "doc/image.h"
+#include "doc/image_traits.h"
+
+#include <algorithm>
+
+namespace doc {
+namespace algorithm {
+
+namespace {
+
+template<typename ImageTraits>
+bool is_transparent(const color_t c, const color_t maskColor)
+{
+  return (c == maskColor);
+}
+
+template<>
+bool is_transparent<RgbTraits>(const color_t c, const color_t)
+{
+  return (rgba_geta(c) == 0);
+}
+
+template<>
+bool is_transparent<GrayscaleTraits>(const color_t c, const color_t)
+{
+  return (graya_geta(c) == 0);
+}
+
+template<typename ImageTraits>
+void image_to_color_rects_templ(const Image* image,
+                                const color_t maskColor,
+                                ColorRects& rects)
+{
+  using address_t = typename ImageTraits::const_address_t;
+
+  const int w = image->width();
+  const int h = image->height();
+
+  // Pixels already included in a rectangle
+  std::vector<uint8_t> used(std::size_t(w) * h, 0);
+
+  for (int y=0; y<h; ++y) {
+    auto row = (address_t)image->getPixelAddress(0, y);
+    uint8_t* usedRow = &used[std::size_t(y) * w];
+
+    for (int x=0; x<w; ) {
+      const color_t c = row[x];
+      if (usedRow[x] || is_transparent<ImageTraits>(c, maskColor)) {
+        ++x;
+        continue;
+      }
+
+      // Extend the run to the right
+      int x2 = x+1;
+      while (x2 < w && !usedRow[x2] && color_t(row[x2]) == c)
+        ++x2;
+
+      // Extend the run downwards while the whole span has the same color
+      int y2 = y+1;
+      for (; y2<h; ++y2) {
+        auto row2 = (address_t)image->getPixelAddress(0, y2);
+        const uint8_t* usedRow2 = &used[std::size_t(y2) * w];
+        int u = x;
+        while (u < x2 && !usedRow2[u] && color_t(row2[u]) == c)
+          ++u;
+        if (u < x2)
+          break;
+      }
+
+      for (int v=y+1; v<y2; ++v)
+        std::fill(used.begin() + std::size_t(v) * w + x,
+                  used.begin() + std::size_t(v) * w + x2, 1);
+
+      rects.emplace_back(gfx::Rect(x, y, x2-x, y2-y), c);
+      x = x2;
+    }
+  }
+}
+
+} // anonymous namespace
+
+void image_to_color_rects(const Image* image,
+                          const color_t maskColor,
+                          ColorRects& rects)
+{
+  DOC_DISPATCH_BY_COLOR_MODE_EXCLUDE_BITMAP(
+    image->colorMode(),
+    image_to_color_rects_templ,
+    image, maskColor, rects);
+}
+
+} // namespace algorithm
+} // namespace doc
@@ -0,0 +1,43 @@
+// Aseprite Document Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_ALGORITHM_COLOR_RECTS_H_INCLUDED
+#define DOC_ALGORITHM_COLOR_RECTS_H_INCLUDED
+#pragma once
+
+#include "doc/color.h"
+#include "gfx/rect.h"
+
+#include <vector>
+
+namespace doc {
+  class Image;
+
+  namespace algorithm {
+
+    struct ColorRect {
+      gfx::Rect bounds;
+      color_t color;
+      ColorRect(const gfx::Rect& bounds, const color_t color)
+        : bounds(bounds), color(color) { }
+    };
+
+    using ColorRects = std::vector<ColorRect>;
+
+    // Converts the image to a list of non-overlapping rectangles
+    // where each rectangle is filled with one color. Horizontal and
+    // vertical runs of the same color are merged (greedily) in
+    // maximal rectangles. Transparent pixels (alpha=0 in RGB and
+    // grayscale images, or pixels equal to the given maskColor in
+    // indexed images) are not included.
+    void image_to_color_rects(const Image* image,
+                              const color_t maskColor,
+                              ColorRects& rects);
+
+  } // namespace algorithm
+} // namespace doc
+
+#endif
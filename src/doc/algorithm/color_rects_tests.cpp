@@ -0,0 +1,156 @@
+// Aseprite Document Library
+// Copyright (c) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "gtest/gtest.h"
+
+#include "doc/algorithm/color_rects.h"
+
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+
+using namespace doc;
+using namespace doc::algorithm;
+using namespace gfx;
+
+// Draws the rectangles in a new image (to compare it with the original)
+static ImageRef draw_rects(const Image* original,
+                           const ColorRects& rects,
+                           const color_t bg)
+{
+  ImageRef image(Image::create(original->pixelFormat(),
+                               original->width(),
+                               original->height()));
+  image->clear(bg);
+  for (const auto& rc : rects) {
+    for (int y=rc.bounds.y; y<rc.bounds.y2(); ++y)
+      for (int x=rc.bounds.x; x<rc.bounds.x2(); ++x) {
+        // Rectangles cannot overlap
+        EXPECT_EQ(bg, get_pixel(image.get(), x, y));
+        put_pixel(image.get(), x, y, rc.color);
+      }
+  }
+  return image;
+}
+
+TEST(ColorRects, PlainImage)
+{
+  ImageRef a(Image::create(IMAGE_RGB, 32, 16));
+  a->clear(rgba(255, 0, 0, 255));
+
+  ColorRects rects;
+  image_to_color_rects(a.get(), 0, rects);
+  ASSERT_EQ(1, rects.size());
+  EXPECT_EQ(Rect(0, 0, 32, 16), rects[0].bounds);
+  EXPECT_EQ(rgba(255, 0, 0, 255), rects[0].color);
+
+  a->clear(rgba(255, 0, 0, 0));
+  rects.clear();
+  image_to_color_rects(a.get(), 0, rects);
+  EXPECT_EQ(0, rects.size());
+}
+
+TEST(ColorRects, IndexedWithMask)
+{
+  ImageRef a(Image::create(IMAGE_INDEXED, 4, 4));
+  a->clear(0);
+  fill_rect(a.get(), 1, 1, 2, 2, 5);
+  put_pixel(a.get(), 3, 0, 7);
+
+  ColorRects rects;
+  image_to_color_rects(a.get(), 0, rects);
+  ASSERT_EQ(2, rects.size());
+  EXPECT_EQ(Rect(3, 0, 1, 1), rects[0].bounds);
+  EXPECT_EQ(7, rects[0].color);
+  EXPECT_EQ(Rect(1, 1, 2, 2), rects[1].bounds);
+  EXPECT_EQ(5, rects[1].color);
+
+  // Without mask color, all pixels are included
+  rects.clear();
+  image_to_color_rects(a.get(), color_t(-1), rects);
+  ImageRef b = draw_rects(a.get(), rects, 255);
+  EXPECT_TRUE(is_same_image(a.get(), b.get()));
+}
+
+TEST(ColorRects, SameRenderAndSize)
+{
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    const color_t bg = 0;
+    ImageRef a(Image::create(pf, 512, 512));
+    a->clear(bg);
+
+    // Some blocks of solid colors over a transparent background
+    // (like typical pixel art)
+    for (int i=0; i<64; ++i) {
+      const int x = (i*37) % 480;
+      const int y = (i*91) % 480;
+      fill_rect(a.get(), x, y, x+31, y+15,
+                (pf == IMAGE_RGB ? rgba(i*4, 255-i*4, 0, 255):
+                 pf == IMAGE_GRAYSCALE ? graya(i*4, 255):
+                                         1+i));
+    }
+
+    int opaquePixels = 0;
+    for (int y=0; y<a->height(); ++y)
+      for (int x=0; x<a->width(); ++x)
+        if (get_pixel(a.get(), x, y) != bg)
+          ++opaquePixels;
+
+    ColorRects rects;
+    image_to_color_rects(a.get(), bg, rects);
+
+    ImageRef b = draw_rects(a.get(), rects, bg);
+    EXPECT_TRUE(is_same_image(a.get(), b.get())) << "Pixel format=" << pf;
+
+    // Merged rectangles must be much less than one element per pixel
+    EXPECT_LT(rects.size() * 10, opaquePixels) << "Pixel format=" << pf;
+  }
+}
+
+TEST(ColorRects, RandomImages)
+{
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    for (int h=1; h<64; h+=7) {
+      for (int w=1; w<64; w+=5) {
+        ImageRef a(Image::create(pf, w, h));
+        // Few opaque colors to generate runs of pixels with the same
+        // color
+        const color_t colors[3] = {
+          (pf == IMAGE_RGB ? rgba(255, 0, 0, 255):
+           pf == IMAGE_GRAYSCALE ? graya(0, 255): 0),
+          (pf == IMAGE_RGB ? rgba(0, 255, 0, 255):
+           pf == IMAGE_GRAYSCALE ? graya(128, 255): 1),
+          (pf == IMAGE_RGB ? rgba(0, 0, 255, 255):
+           pf == IMAGE_GRAYSCALE ? graya(255, 255): 2) };
+        for (int y=0; y<h; ++y)
+          for (int x=0; x<w; ++x)
+            put_pixel(a.get(), x, y, colors[std::rand() % 3]);
+
+        ColorRects rects;
+        image_to_color_rects(a.get(), color_t(-1), rects);
+
+        ImageRef b = draw_rects(a.get(), rects, 0);
+
+        EXPECT_TRUE(is_same_image(a.get(), b.get()))
+          << "Pixel format=" << pf << " Size=" << w << "x" << h;
+
+        // All pixels covered exactly once
+        int area = 0;
+        for (const auto& rc : rects)
+          area += rc.bounds.w * rc.bounds.h;
+        EXPECT_EQ(w*h, area);
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020 Igara Studio S.A.
+// Copyright (c) 2020-2024 Igara Studio S.A.
 // Copyright (c) 2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,14 +11,103 @@
 
 #include "doc/algorithm/fill_selection.h"
 
+#include "doc/algorithm/mask_runs.h"
+#include "doc/dispatch.h"
 #include "doc/grid.h"
-#include "doc/image_impl.h"
+#include "doc/image.h"
 #include "doc/mask.h"
 #include "doc/primitives.h"
 
+#include <algorithm>
+
 namespace doc {
 namespace algorithm {
 
+namespace {
+
+// Fills the span [x1, x2] of the "y" row of the image (clipped to
+// the image bounds).
+template<typename ImageTraits>
+void fill_span(Image* image, int x1, const int y, int x2,
+               const color_t color)
+{
+  if (y < 0 || y >= image->height())
+    return;
+
+  x1 = std::max(x1, 0);
+  x2 = std::min(x2, image->width()-1);
+  if (x1 > x2)
+    return;
+
+  if constexpr (ImageTraits::pixels_per_byte == 0) {
+    auto row = (typename ImageTraits::address_t)image->getPixelAddress(0, y);
+    std::fill(row+x1, row+x2+1,
+              (typename ImageTraits::pixel_t)color);
+  }
+  else {
+    image->drawHLine(x1, y, x2, color);
+  }
+}
+
+template<typename ImageTraits>
+void fill_selection_templ(Image* image,
+                          const gfx::Rect& imageBounds,
+                          const Mask* mask,
+                          const gfx::Rect& rc,
+                          const color_t color,
+                          const Grid* grid)
+{
+  const Image* bitmap = mask->bitmap();
+  const gfx::Point origin = mask->origin();
+
+  // Columns of the mask bitmap inside the "rc" intersection
+  const int u0 = rc.x - origin.x;
+  const int u3 = rc.x2() - origin.x;
+
+  // Tiles are a simple division of the canvas when the grid doesn't
+  // have odd row/column offsets (e.g. isometric grids), so a run of
+  // pixels is a run of tiles too.
+  const bool regularGrid =
+    (!grid ||
+     (grid->oddRowOffset() == gfx::Point(0, 0) &&
+      grid->oddColOffset() == gfx::Point(0, 0)));
+
+  for (int y=rc.y; y<rc.y2(); ++y) {
+    const uint8_t* maskRow = bitmap->getPixelAddress(0, y - origin.y);
+
+    for_each_mask_run(
+      maskRow, bitmap->width(), true,
+      [&](int u1, int u2) {
+        u1 = std::max(u1, u0);
+        u2 = std::min(u2, u3);
+        if (u1 >= u2)
+          return;
+
+        gfx::Point a(u1 + origin.x, y);
+        gfx::Point b(u2 - 1 + origin.x, y);
+
+        if (!grid) {
+          a -= imageBounds.origin();
+          b -= imageBounds.origin();
+          fill_span<ImageTraits>(image, a.x, a.y, b.x, color);
+        }
+        else if (regularGrid) {
+          a = grid->canvasToTile(a);
+          b = grid->canvasToTile(b);
+          fill_span<ImageTraits>(image, a.x, a.y, b.x, color);
+        }
+        else {
+          for (; a.x<=b.x; ++a.x) {
+            const gfx::Point pt = grid->canvasToTile(a);
+            put_pixel(image, pt.x, pt.y, color);
+          }
+        }
+      });
+  }
+}
+
+} // anonymous namespace
+
 void fill_selection(Image* image,
                     const gfx::Rect& imageBounds,
                     const Mask* mask,
@@ -34,31 +123,10 @@ void fill_selection(Image* image,
   if (rc.isEmpty())
     return; // <- There is no intersection between image bounds and mask bounds
 
-  const LockImageBits<BitmapTraits> maskBits(mask->bitmap(),
-                                             gfx::Rect(rc).offset(-mask->origin()));
-  auto it = maskBits.begin();
-
-  for (int v=0; v<rc.h; ++v) {
-    for (int u=0; u<rc.w; ++u, ++it) {
-      ASSERT(it != maskBits.end());
-      if (*it) {
-        gfx::Point pt(u + rc.x,
-                      v + rc.y);
-
-        if (grid) {
-          pt = grid->canvasToTile(pt);
-        }
-        else {
-          pt -= imageBounds.origin();
-        }
-
-        // TODO use iterator
-        put_pixel(image, pt.x, pt.y, color);
-      }
-    }
-  }
-
-  ASSERT(it == maskBits.end());
+  DOC_DISPATCH_BY_COLOR_MODE(
+    image->colorMode(),
+    fill_selection_templ,
+    image, imageBounds, mask, rc, color, grid);
 }
 
 } // namespace algorithm
@@ -0,0 +1,101 @@
+// Aseprite Document Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/algorithm/fill_selection.h"
+#include "doc/algorithm/stroke_selection.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+
+using namespace doc;
+
+enum MaskKind { kEllipse, kChecked, kRandom };
+
+// Creates a big selection (kEllipse), or a fragmented one (kChecked
+// with 4x4 squares, kRandom with random pixels).
+static void create_mask(Mask& mask, const MaskKind kind,
+                        const int w, const int h)
+{
+  mask.replace(gfx::Rect(0, 0, w, h));
+  mask.freeze();
+  Image* bitmap = mask.bitmap();
+  switch (kind) {
+    case kEllipse:
+      clear_image(bitmap, 0);
+      fill_ellipse(bitmap, 0, 0, w-1, h-1, 0, 0, 1);
+      break;
+    case kChecked:
+      for (int y=0; y<h; ++y)
+        for (int x=0; x<w; ++x)
+          bitmap->putPixel(x, y, ((x/4) + (y/4)) & 1);
+      break;
+    case kRandom:
+      std::srand(1);
+      for (int y=0; y<h; ++y)
+        for (int x=0; x<w; ++x)
+          bitmap->putPixel(x, y, std::rand() & 1);
+      break;
+  }
+  mask.unfreeze();
+}
+
+void BM_FillSelection(benchmark::State& state) {
+  const auto kind = (MaskKind)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+
+  Mask mask;
+  create_mask(mask, kind, w, h);
+  ImageRef image(Image::create(IMAGE_RGB, w, h));
+
+  for (auto _ : state)
+    algorithm::fill_selection(image.get(), image->bounds(), &mask,
+                              rgba(255, 0, 0, 255));
+}
+
+void BM_StrokeSelection(benchmark::State& state) {
+  const auto kind = (MaskKind)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+
+  Mask mask;
+  create_mask(mask, kind, w, h);
+  ImageRef image(Image::create(IMAGE_RGB, w, h));
+
+  for (auto _ : state)
+    algorithm::stroke_selection(image.get(), image->bounds(), &mask,
+                                rgba(255, 0, 0, 255));
+}
+
+#define DEFARGS(KIND)                      \
+  ->Args({ KIND, 256, 256 })               \
+  ->Args({ KIND, 1024, 1024 })             \
+  ->Args({ KIND, 4096, 4096 })
+
+BENCHMARK(BM_FillSelection)
+  DEFARGS(kEllipse)
+  DEFARGS(kChecked)
+  DEFARGS(kRandom)
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
+BENCHMARK(BM_StrokeSelection)
+  DEFARGS(kEllipse)
+  DEFARGS(kChecked)
+  DEFARGS(kRandom)
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020 Igara Studio S.A.
+// Copyright (c) 2020-2024 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -7,10 +7,14 @@
 #include "gtest/gtest.h"
 
 #include "doc/algorithm/fill_selection.h"
+#include "doc/algorithm/modify_selection.h"
+#include "doc/algorithm/stroke_selection.h"
 #include "doc/grid.h"
 #include "doc/image.h"
 #include "doc/mask.h"
 
+#include <cstdlib>
+
 using namespace doc;
 using namespace gfx;
 
@@ -94,6 +98,68 @@ TEST(FillSelection, Tilemap)
                         1, 1, 1, 1 }, image.get()));
 }
 
+// Creates a fragmented selection with random pixels
+static void random_mask(Mask& mask, const Rect& bounds)
+{
+  mask.replace(bounds);
+  mask.freeze();
+  Image* bitmap = mask.bitmap();
+  for (int y=0; y<bitmap->height(); ++y)
+    for (int x=0; x<bitmap->width(); ++x)
+      bitmap->putPixel(x, y, (std::rand() % 3) != 0);
+  mask.unfreeze();
+}
+
+TEST(FillSelection, RandomMasks)
+{
+  std::srand(1);
+  for (int w : { 1, 7, 8, 9, 63, 64, 65, 130 }) {
+    Mask mask;
+    random_mask(mask, Rect(3, 2, w, 5));
+
+    ImageRef image(Image::create(IMAGE_INDEXED, 140, 10));
+    image->clear(0);
+    const Rect imageBounds(1, 0, 140, 10);
+    algorithm::fill_selection(image.get(), imageBounds, &mask, 1, nullptr);
+
+    for (int y=0; y<image->height(); ++y)
+      for (int x=0; x<image->width(); ++x)
+        ASSERT_EQ(mask.containsPoint(x+1, y) ? 1: 0,
+                  int(image->getPixel(x, y)));
+  }
+}
+
+TEST(StrokeSelection, SameAsBorderModifier)
+{
+  std::srand(2);
+  for (int w : { 1, 2, 7, 8, 9, 63, 64, 65, 130 }) {
+    Mask mask;
+    random_mask(mask, Rect(0, 0, w, 6));
+    if (mask.isEmpty())
+      continue;
+
+    Mask border;
+    border.reserve(mask.bounds());
+    border.freeze();
+    algorithm::modify_selection(
+      algorithm::SelectionModifier::Border,
+      &mask, &border, 1, kCircleBrushType);
+    border.unfreeze();
+
+    const Rect bounds = mask.bounds();
+    ImageRef expected(Image::create(IMAGE_INDEXED, bounds.w, bounds.h));
+    ImageRef image(Image::create(IMAGE_INDEXED, bounds.w, bounds.h));
+    expected->clear(0);
+    image->clear(0);
+    algorithm::fill_selection(expected.get(), bounds, &border, 1, nullptr);
+    algorithm::stroke_selection(image.get(), bounds, &mask, 1, nullptr);
+
+    for (int y=0; y<bounds.h; ++y)
+      for (int x=0; x<bounds.w; ++x)
+        ASSERT_EQ(expected->getPixel(x, y), image->getPixel(x, y));
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
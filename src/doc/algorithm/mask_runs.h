@@ -0,0 +1,89 @@
+// Aseprite Document Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_ALGORITHM_MASK_RUNS_H_INCLUDED
+#define DOC_ALGORITHM_MASK_RUNS_H_INCLUDED
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace doc {
+  namespace algorithm {
+
+    // Returns the number of trailing zero bits of x (x != 0)
+    inline int mask_runs_ctz(const uint64_t x) {
+#ifdef _MSC_VER
+      unsigned long i;
+      _BitScanForward64(&i, x);
+      return int(i);
+#else
+      return __builtin_ctzll(x);
+#endif
+    }
+
+    // Calls f(u1, u2) for each run [u1, u2) of pixels in the given row
+    // of a mask bitmap with the bit equal to "value". The row is
+    // processed 64 pixels at a time, jumping from one run edge to the
+    // next one counting trailing zeros, so big selected/unselected
+    // areas are skipped at once.
+    template<typename Func>
+    inline void for_each_mask_run(const uint8_t* row, const int w,
+                                  const bool value, Func f)
+    {
+      int runStart = -1;
+
+      for (int base=0; base<w; base+=64, row+=8) {
+        // Bits are stored from the least significant bit (see
+        // ImageImpl<BitmapTraits>::getPixel()), so pixel "base+u" is
+        // the bit "u" of this word.
+        const int n = std::min(64, w-base);
+        uint64_t word = 0;
+        if (n == 64) {
+          for (int i=0; i<8; ++i)
+            word |= (uint64_t(row[i]) << (8*i));
+        }
+        else {
+          for (int i=0; i<(n+7)/8; ++i)
+            word |= (uint64_t(row[i]) << (8*i));
+        }
+        if (!value)
+          word = ~word;
+        if (n < 64)
+          word &= (uint64_t(1) << n) - 1;
+
+        int u = 0;
+        while (u < n) {
+          if (runStart < 0) {
+            const uint64_t t = (word >> u);
+            if (!t)
+              break;
+            u += mask_runs_ctz(t);
+            runStart = base+u;
+          }
+          else {
+            const uint64_t t = (~word >> u);
+            if (!t)
+              break;            // The run continues in the next word
+            u += mask_runs_ctz(t);
+            f(runStart, base+u);
+            runStart = -1;
+          }
+        }
+      }
+
+      if (runStart >= 0)
+        f(runStart, w);
+    }
+
+  } // namespace algorithm
+} // namespace doc
+
+#endif
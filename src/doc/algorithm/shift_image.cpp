@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2020 Igara Studio S.A.
+// Copyright (c) 2019-2024 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -20,11 +20,77 @@
 #include "doc/primitives.h"
 #include "gfx/rect.h"
 
+#include <cstring>
 #include <vector>
 
 namespace doc {
 namespace algorithm {
 
+namespace {
+
+// Rotates (wrapping around) the pixels inside the given "bounds" of
+// the image, "dx" pixels to the right and "dy" pixels down. Whole
+// rows are moved with memcpy()/memmove() (the right part of each
+// source row goes to the left part of the destination row, and vice
+// versa).
+void rotate_pixels(Image* image, const gfx::Rect& bounds, int dx, int dy)
+{
+  const int w = bounds.w;
+  const int h = bounds.h;
+  if (w < 1 || h < 1)
+    return;
+
+  // Use floor modulo (Euclidean remainder)
+  dx = ((dx % w) + w) % w;
+  dy = ((dy % h) + h) % h;
+  if (dx == 0 && dy == 0)
+    return;
+
+  // Pixels of bitmaps aren't byte-aligned
+  if (image->pixelFormat() == IMAGE_BITMAP) {
+    ImageRef crop(crop_image(image, bounds.x, bounds.y, w, h,
+                             image->maskColor()));
+    for (int y=0; y<h; ++y)
+      for (int x=0; x<w; ++x)
+        put_pixel(image,
+                  bounds.x + (x + dx) % w,
+                  bounds.y + (y + dy) % h,
+                  get_pixel(crop.get(), x, y));
+    return;
+  }
+
+  const int rowBytes = w * image->bytesPerPixel();
+  const int wrapBytes = dx * image->bytesPerPixel();
+
+  // Horizontal shift only: rotate each row in place
+  if (dy == 0) {
+    std::vector<uint8_t> tmp(wrapBytes);
+    for (int y=0; y<h; ++y) {
+      uint8_t* row = image->getPixelAddress(bounds.x, bounds.y+y);
+      std::memcpy(tmp.data(), row+rowBytes-wrapBytes, wrapBytes);
+      std::memmove(row+wrapBytes, row, rowBytes-wrapBytes);
+      std::memcpy(row, tmp.data(), wrapBytes);
+    }
+    return;
+  }
+
+  // Rows change their position, so we copy the whole area first
+  std::vector<uint8_t> copy(std::size_t(rowBytes) * h);
+  for (int y=0; y<h; ++y)
+    std::memcpy(&copy[std::size_t(y) * rowBytes],
+                image->getPixelAddress(bounds.x, bounds.y+y),
+                rowBytes);
+
+  for (int y=0; y<h; ++y) {
+    const uint8_t* src = &copy[std::size_t(y) * rowBytes];
+    uint8_t* dst = image->getPixelAddress(bounds.x, bounds.y + (y + dy) % h);
+    std::memcpy(dst+wrapBytes, src, rowBytes-wrapBytes);
+    std::memcpy(dst, src+rowBytes-wrapBytes, wrapBytes);
+  }
+}
+
+} // anonymous namespace
+
 void shift_image(Image* image, int dx, int dy, double angle)
 {
   gfx::Rect bounds(image->bounds());
@@ -44,19 +110,8 @@ void shift_image(Image* image, int dx, int dy, double angle)
     dx = dy;
     dy = -aux;
   }
-  // To simplify the algorithm we use a copy of the original image, we
-  // could avoid this copy swapping rows and columns.
-  ImageRef crop(crop_image(image, bounds.x, bounds.y, bounds.w, bounds.h,
-                           image->maskColor()));
 
-  for (int y=0; y<bounds.h; ++y) {
-    for (int x=0; x<bounds.w; ++x) {
-        put_pixel(image,
-                  (bounds.w + dx + x) % bounds.w,
-                  (bounds.h + dy + y) % bounds.h,
-                  get_pixel(crop.get(), x, y));
-    }
-  }
+  rotate_pixels(image, bounds, dx, dy);
 }
 
 ImageRef shift_image_with_mask(const Cel* cel,
@@ -87,31 +142,8 @@ ImageRef shift_image_with_mask(const Cel* cel,
                                           0, 0,
                                           cel->bounds().w, cel->bounds().h));
 
-  // Making a copy of only the image which will be shiftted
-  ImageRef imageToShift(Image::create(compImage->pixelFormat(), maskedBounds.w, maskedBounds.h));
-  imageToShift->copy(compImage.get(), gfx::Clip(0, 0, maskedBounds));
-
   // Shifting the masked area of the COMPOUND IMAGE (compImage).
-  const int xInitial = maskedBounds.x;
-  const int yInitial = maskedBounds.y;
-  const int wMask = maskedBounds.w;
-  const int hMask = maskedBounds.h;
-  for (int y=0; y<hMask; ++y) {
-    for (int x=0; x<wMask; ++x) {
-      // Use floor modulo (Euclidean remainder).
-      // Shifts are broken out and stored in separate variables
-      // to make them easier to recognize and change in the event
-      // that rem_eucl is implemented formally in the future.
-      const int xShift = ((dx + x) % wMask + wMask) % wMask;
-      const int yShift = ((dy + y) % hMask + hMask) % hMask;
-
-      put_pixel(
-        compImage.get(),
-        xInitial + xShift,
-        yInitial + yShift,
-        get_pixel(imageToShift.get(), x, y));
-    }
-  }
+  rotate_pixels(compImage.get(), maskedBounds, dx, dy);
 
   // Bounds and Image shrinking (we have to fit compound image (compImage) and bounds (compCelBounds))
   gfx::Rect newBounds = compImage->bounds();
@@ -0,0 +1,61 @@
+// Aseprite Document Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/shift_image.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+
+#include <cstdlib>
+
+using namespace doc;
+
+TEST(ShiftImage, WrapAround)
+{
+  std::srand(1);
+  for (PixelFormat pixelFormat : { IMAGE_RGB,
+                                   IMAGE_GRAYSCALE,
+                                   IMAGE_INDEXED,
+                                   IMAGE_BITMAP }) {
+    ImageRef orig(Image::create(pixelFormat, 13, 7));
+    for (int y=0; y<orig->height(); ++y)
+      for (int x=0; x<orig->width(); ++x)
+        put_pixel(orig.get(), x, y,
+                  (pixelFormat == IMAGE_BITMAP ? std::rand() & 1:
+                                                 std::rand() & 0xff));
+
+    for (int dy : { 0, 1, -3, 9 }) {
+      for (int dx : { 0, 2, -5, 14, -13 }) {
+        ImageRef image(Image::createCopy(orig.get()));
+        algorithm::shift_image(image.get(), dx, dy, 0.0);
+
+        const int w = image->width();
+        const int h = image->height();
+        for (int y=0; y<h; ++y) {
+          for (int x=0; x<w; ++x) {
+            ASSERT_EQ(get_pixel(orig.get(), x, y),
+                      get_pixel(image.get(),
+                                (((x + dx) % w) + w) % w,
+                                (((y + dy) % h) + h) % h))
+              << "dx=" << dx << " dy=" << dy;
+          }
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -21,11 +21,68 @@
 
 #include <algorithm>
 #include <cmath>
+#include <list>
+#include <mutex>
 
 namespace doc {
 
 static int generation = 0;
 
+namespace {
+
+// Process-wide LRU cache of rasterized brushes (circle, square, and
+// line brushes), so changing the brush size/angle back and forth
+// (e.g. with the mouse wheel or with pressure dynamics) doesn't
+// rasterize the same brush again and again. The cached images are
+// never modified (setImageColor() is only used with image brushes).
+class BrushCache {
+public:
+  struct Entry {
+    BrushType type;
+    int size;
+    int angle;
+    ImageRef image;
+    int gen;
+    std::shared_ptr<const MaskBoundaries> boundaries;
+  };
+
+  static BrushCache& instance() {
+    static BrushCache cache;
+    return cache;
+  }
+
+  bool find(BrushType type, int size, int angle, Entry& result) {
+    std::lock_guard lock(m_mutex);
+    for (auto it=m_entries.begin(); it!=m_entries.end(); ++it) {
+      if (it->type == type &&
+          it->size == size &&
+          it->angle == angle) {
+        // Move to the front as the most recently used entry
+        if (it != m_entries.begin())
+          m_entries.splice(m_entries.begin(), m_entries, it);
+        result = m_entries.front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void add(const Entry& entry) {
+    std::lock_guard lock(m_mutex);
+    m_entries.push_front(entry);
+    if (m_entries.size() > kMaxEntries)
+      m_entries.pop_back();
+  }
+
+private:
+  static constexpr size_t kMaxEntries = 128;
+
+  std::mutex m_mutex;
+  std::list<Entry> m_entries;   // Most recently used first
+};
+
+} // anonymous namespace
+
 Brush::Brush()
 {
   m_type = kCircleBrushType;
@@ -110,6 +167,10 @@ void Brush::setImage(const Image* image,
   m_mainColor.reset();
   m_bgColor.reset();
 
+  auto boundaries = std::make_shared<MaskBoundaries>();
+  boundaries->regen(m_maskBitmap.get());
+  m_boundaries = std::move(boundaries);
+
   resetBounds();
 }
 
@@ -295,6 +356,12 @@ void Brush::setCenter(const gfx::Point& center)
                                  m_image->height()));
 }
 
+const MaskBoundaries& Brush::boundaries() const
+{
+  static const MaskBoundaries empty;
+  return (m_boundaries ? *m_boundaries: empty);
+}
+
 // Cleans the brush's data (image and region).
 void Brush::clean()
 {
@@ -302,6 +369,7 @@ void Brush::clean()
   m_image.reset();
   m_maskBitmap.reset();
   m_backupImage.reset();
+  m_boundaries.reset();
 }
 
 static void algo_hline(int x1, int y, int x2, void *data)
@@ -316,6 +384,20 @@ void Brush::regenerate()
 
   ASSERT(m_size > 0);
 
+  // The angle doesn't change the shape of circles and small squares
+  const int angle =
+    (m_type == kCircleBrushType ||
+     (m_type == kSquareBrushType && m_size <= 2) ? 0: m_angle);
+
+  BrushCache::Entry entry;
+  if (BrushCache::instance().find(m_type, m_size, angle, entry)) {
+    m_image = entry.image;
+    m_gen = entry.gen;
+    m_boundaries = entry.boundaries;
+    resetBounds();
+    return;
+  }
+
   int size = m_size;
   if (m_type == kSquareBrushType && m_angle != 0 && m_size > 2)
     size = (int)std::sqrt((double)2*m_size*m_size)+2;
@@ -374,6 +456,15 @@ void Brush::regenerate()
       }
     }
   }
+
+  // The boundaries are generated before the entry is shared in the
+  // cache, so they are never modified by other threads
+  auto boundaries = std::make_shared<MaskBoundaries>();
+  boundaries->regen(m_image.get());
+  m_boundaries = std::move(boundaries);
+
+  BrushCache::instance().add(
+    BrushCache::Entry{ m_type, m_size, angle, m_image, m_gen, m_boundaries });
 }
 
 void Brush::resetBounds()
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,6 +13,7 @@
 #include "doc/brush_type.h"
 #include "doc/color.h"
 #include "doc/image_ref.h"
+#include "doc/mask_boundaries.h"
 #include "gfx/point.h"
 #include "gfx/rect.h"
 
@@ -48,6 +49,12 @@ namespace doc {
     const gfx::Rect& bounds() const { return m_bounds; }
     const gfx::Point& center() const { return m_center; }
 
+    // Returns the boundaries of the brush shape in brush image
+    // coordinates (i.e. without the -center() offset). They are
+    // generated with the brush image, and shared between all brushes
+    // with the same type/size/angle.
+    const MaskBoundaries& boundaries() const;
+
     void setType(BrushType type);
     void setSize(int size);
     void setAngle(int angle);
@@ -94,6 +101,7 @@ namespace doc {
     gfx::Point m_patternOrigin;           // From what position the brush was taken
     ImageRef m_patternImage;
     int m_gen;
+    std::shared_ptr<const MaskBoundaries> m_boundaries;
 
     // Extra data used for setImageColor()
     ImageRef m_backupImage; // Backup image to avoid losing original brush colors/pattern
@@ -0,0 +1,81 @@
+// Aseprite Document Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/brush.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+
+#include <thread>
+#include <vector>
+
+using namespace doc;
+
+TEST(Brush, SharedRasterization)
+{
+  Brush a(kCircleBrushType, 9, 0);
+  Brush b(kCircleBrushType, 9, 45);
+  Brush c(kSquareBrushType, 9, 45);
+
+  // Same shape, same image
+  EXPECT_EQ(a.image(), b.image());
+  EXPECT_EQ(a.gen(), b.gen());
+  EXPECT_NE(a.image(), c.image());
+
+  EXPECT_FALSE(a.boundaries().isEmpty());
+  EXPECT_EQ(&a.boundaries(), &b.boundaries());
+
+  // Changing the size and going back reuses the same image
+  const Image* image = a.image();
+  a.setSize(10);
+  EXPECT_NE(image, a.image());
+  a.setSize(9);
+  EXPECT_EQ(image, a.image());
+}
+
+TEST(Brush, BoundariesFromSeveralThreads)
+{
+  // Brushes created and used from several threads share the
+  // boundaries of the same cache entries
+  std::vector<std::thread> threads;
+  std::vector<int> segments(8, 0);
+  for (int i=0; i<int(segments.size()); ++i) {
+    threads.emplace_back([i, &segments]{
+      for (int size=40; size<60; ++size) {
+        Brush brush(kCircleBrushType, size, 0);
+        const MaskBoundaries& boundaries = brush.boundaries();
+        EXPECT_FALSE(boundaries.isEmpty());
+        segments[i] += int(boundaries.end() - boundaries.begin());
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  for (int n : segments)
+    EXPECT_EQ(segments[0], n);
+
+  // Image brushes generate their boundaries from the mask bitmap
+  ImageRef image(Image::create(IMAGE_RGB, 4, 4));
+  clear_image(image.get(), 0);
+  put_pixel(image.get(), 1, 1, rgba(255, 0, 0, 255));
+  Brush brush;
+  brush.setImage(image.get(), nullptr);
+  const MaskBoundaries& boundaries = brush.boundaries();
+  EXPECT_EQ(4, boundaries.end() - boundaries.begin());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -68,7 +68,15 @@ void Cel::setFrame(frame_t frame)
 void Cel::setDataRef(const CelDataRef& celData)
 {
   ASSERT(celData);
-  m_data = celData;
+
+  // Update the index of linked cels of the layer
+  if (m_layer) {
+    m_layer->removeCelLink(this);
+    m_data = celData;
+    m_layer->addCelLink(this);
+  }
+  else
+    m_data = celData;
 }
 
 void Cel::setPosition(int x, int y)
@@ -99,6 +107,10 @@ void Cel::setOpacity(int opacity)
 void Cel::setZIndex(int zindex)
 {
   m_zIndex = zindex;
+
+  // The z-index changes the order of cels in the RenderPlan
+  if (m_layer && m_layer->sprite())
+    m_layer->sprite()->incrementStructureVersion();
 }
 
 Document* Cel::document() const
@@ -122,15 +134,14 @@ Sprite* Cel::sprite() const
 Cel* Cel::link() const
 {
   ASSERT(m_data);
-  if (m_data.get() == NULL)
+  if (m_data.get() == NULL || !m_layer)
     return NULL;
 
   if (!m_data.unique()) {
-    for (frame_t fr=0; fr<m_frame; ++fr) {
-      Cel* possible = m_layer->cel(fr);
-      if (possible && possible->dataRef().get() == m_data.get())
-        return possible;
-    }
+    // The first cel (ordered by frame) is the original one
+    const CelList* cels = m_layer->linkedCels(m_data.get());
+    if (cels && cels->front() != this)
+      return cels->front();
   }
 
   return NULL;
@@ -138,16 +149,11 @@ Cel* Cel::link() const
 
 std::size_t Cel::links() const
 {
-  std::size_t links = 0;
-
-  Sprite* sprite = this->sprite();
-  for (frame_t fr=0; fr<sprite->totalFrames(); ++fr) {
-    Cel* cel = m_layer->cel(fr);
-    if (cel && cel != this && cel->dataRef().get() == m_data.get())
-      ++links;
-  }
+  if (!m_layer)
+    return 0;
 
-  return links;
+  const CelList* cels = m_layer->linkedCels(m_data.get());
+  return (cels ? cels->size()-1: 0);
 }
 
 void Cel::setParentLayer(LayerImage* layer)
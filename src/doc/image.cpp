@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2020 Igara Studio S.A.
+// Copyright (c) 2018-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -23,6 +23,8 @@ namespace doc {
 Image::Image(const ImageSpec& spec)
   : Object(ObjectType::Image)
   , m_spec(spec)
+  , m_compressedDataVersion(0)
+  , m_compressedDataHash(0)
 {
 }
 
@@ -32,7 +34,23 @@ Image::~Image()
 
 int Image::getMemSize() const
 {
-  return sizeof(Image) + rowBytes()*height();
+  return sizeof(Image) + rowBytes()*height() + m_compressedData.size();
+}
+
+void Image::setCompressedData(base::buffer&& buffer, uint32_t hash) const
+{
+  m_compressedData = std::move(buffer);
+  m_compressedDataVersion = version();
+  m_compressedDataHash = hash;
+}
+
+void Image::discardCompressedData() const
+{
+  if (!m_compressedData.empty()) {
+    base::buffer().swap(m_compressedData);
+    m_compressedDataVersion = 0;
+    m_compressedDataHash = 0;
+  }
 }
 
 // static
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,6 +9,7 @@
 #define DOC_IMAGE_H_INCLUDED
 #pragma once
 
+#include "base/buffer.h"
 #include "doc/color.h"
 #include "doc/color_mode.h"
 #include "doc/image_buffer.h"
@@ -72,6 +73,17 @@ namespace doc {
 
     virtual int getMemSize() const override;
 
+    // Cached compressed pixels written in .aseprite files, so saving
+    // the same image again doesn't need re-compressing it. The data
+    // can be re-used only if the image version and the hash of its
+    // pixels (calculate_image_hash()) didn't change. The data is
+    // included in getMemSize().
+    void setCompressedData(base::buffer&& buffer, uint32_t hash) const;
+    void discardCompressedData() const;
+    const base::buffer& compressedData() const { return m_compressedData; }
+    ObjectVersion compressedDataVersion() const { return m_compressedDataVersion; }
+    uint32_t compressedDataHash() const { return m_compressedDataHash; }
+
     template<typename ImageTraits>
     ImageBits<ImageTraits> lockBits(LockType lockType, const gfx::Rect& bounds) {
       return ImageBits<ImageTraits>(this, bounds);
@@ -107,6 +119,9 @@ namespace doc {
 
   private:
     ImageSpec m_spec;
+    mutable base::buffer m_compressedData;
+    mutable ObjectVersion m_compressedDataVersion;
+    mutable uint32_t m_compressedDataHash;
   };
 
 } // namespace doc
@@ -46,6 +46,26 @@ int Layer::getMemSize() const
   return sizeof(Layer);
 }
 
+void Layer::setFlags(LayerFlags flags)
+{
+  if (m_flags == flags)
+    return;
+
+  m_flags = flags;
+
+  // The visibility of the layer changes the RenderPlan
+  if (m_sprite)
+    m_sprite->incrementStructureVersion();
+}
+
+void Layer::switchFlags(LayerFlags flags, bool state)
+{
+  if (state)
+    setFlags(LayerFlags(int(m_flags) | int(flags)));
+  else
+    setFlags(LayerFlags(int(m_flags) & ~int(flags)));
+}
+
 Layer* Layer::getPrevious() const
 {
   if (m_parent) {
@@ -270,6 +290,7 @@ void LayerImage::destroyAllCels()
     delete cel;
   }
   m_cels.clear();
+  m_links.clear();
 }
 
 Cel* LayerImage::cel(frame_t frame) const
@@ -338,6 +359,43 @@ CelIterator LayerImage::findFirstCelIteratorAfter(frame_t firstAfterFrame)
   return first;
 }
 
+const CelList* LayerImage::linkedCels(const CelData* celData) const
+{
+  auto it = m_links.find(celData);
+  if (it != m_links.end())
+    return &it->second;
+  else
+    return nullptr;
+}
+
+void LayerImage::addCelLink(Cel* cel)
+{
+  CelList& cels = m_links[cel->data()];
+  cels.insert(
+    std::lower_bound(cels.begin(), cels.end(), cel,
+                     [](const Cel* a, const Cel* b) -> bool {
+                       return a->frame() < b->frame();
+                     }),
+    cel);
+}
+
+void LayerImage::removeCelLink(Cel* cel)
+{
+  auto it = m_links.find(cel->data());
+  ASSERT(it != m_links.end());
+  if (it == m_links.end())
+    return;
+
+  CelList& cels = it->second;
+  auto celIt = std::find(cels.begin(), cels.end(), cel);
+  ASSERT(celIt != cels.end());
+  if (celIt != cels.end())
+    cels.erase(celIt);
+
+  if (cels.empty())
+    m_links.erase(it);
+}
+
 void LayerImage::addCel(Cel* cel)
 {
   ASSERT(cel);
@@ -349,8 +407,10 @@ void LayerImage::addCel(Cel* cel)
 
   CelIterator it = findFirstCelIteratorAfter(cel->frame());
   m_cels.insert(it, cel);
+  addCelLink(cel);
 
   cel->setParentLayer(this);
+  sprite()->incrementStructureVersion();
 }
 
 /**
@@ -366,8 +426,11 @@ void LayerImage::removeCel(Cel* cel)
   ASSERT(it != m_cels.end());
 
   m_cels.erase(it);
+  removeCelLink(cel);
 
   cel->setParentLayer(NULL);
+  if (Sprite* spr = sprite())
+    spr->incrementStructureVersion();
 }
 
 void LayerImage::moveCel(Cel* cel, frame_t frame)
@@ -550,6 +613,8 @@ void LayerGroup::addLayer(Layer* layer)
 {
   m_layers.push_back(layer);
   layer->setParent(this);
+  if (Sprite* spr = sprite())
+    spr->incrementStructureVersion();
 }
 
 void LayerGroup::removeLayer(Layer* layer)
@@ -559,6 +624,8 @@ void LayerGroup::removeLayer(Layer* layer)
   m_layers.erase(it);
 
   layer->setParent(nullptr);
+  if (Sprite* spr = sprite())
+    spr->incrementStructureVersion();
 }
 
 void LayerGroup::insertLayer(Layer* layer, Layer* after)
@@ -572,6 +639,8 @@ void LayerGroup::insertLayer(Layer* layer, Layer* after)
   m_layers.insert(after_it, layer);
 
   layer->setParent(this);
+  if (Sprite* spr = sprite())
+    spr->incrementStructureVersion();
 }
 
 void LayerGroup::stackLayer(Layer* layer, Layer* after)
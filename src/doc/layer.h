@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -17,10 +17,12 @@
 #include "doc/with_user_data.h"
 
 #include <string>
+#include <unordered_map>
 
 namespace doc {
 
   class Cel;
+  class CelData;
   class Grid;
   class Image;
   class Layer;
@@ -111,16 +113,8 @@ namespace doc {
       return (int(m_flags) & int(flags)) == int(flags);
     }
 
-    void setFlags(LayerFlags flags) {
-      m_flags = flags;
-    }
-
-    void switchFlags(LayerFlags flags, bool state) {
-      if (state)
-        m_flags = LayerFlags(int(m_flags) | int(flags));
-      else
-        m_flags = LayerFlags(int(m_flags) & ~int(flags));
-    }
+    void setFlags(LayerFlags flags);
+    void switchFlags(LayerFlags flags, bool state);
 
     virtual Grid grid() const;
     virtual Cel* cel(frame_t frame) const;
@@ -167,6 +161,11 @@ namespace doc {
     CelIterator findCelIterator(frame_t frame);
     CelIterator findFirstCelIteratorAfter(frame_t firstAfterFrame);
 
+    // Returns the cels of this layer that share the given CelData
+    // (linked cels) ordered by frame, or nullptr if there is no cel
+    // using this CelData.
+    const CelList* linkedCels(const CelData* celData) const;
+
     void configureAsBackground();
 
     CelIterator getCelBegin() { return m_cels.begin(); }
@@ -177,10 +176,18 @@ namespace doc {
 
   private:
     void destroyAllCels();
+    void addCelLink(Cel* cel);
+    void removeCelLink(Cel* cel);
 
     BlendMode m_blendmode;
     int m_opacity;
     CelList m_cels;   // List of all cels inside this layer used by frames.
+
+    // Index of cels by CelData (to find linked cels quickly, see
+    // Cel::link() and Cel::links())
+    std::unordered_map<const CelData*, CelList> m_links;
+
+    friend class Cel;
   };
 
   //////////////////////////////////////////////////////////////////////
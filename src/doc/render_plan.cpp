@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2024  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -12,12 +12,17 @@
 
 #include "doc/cel.h"
 #include "doc/layer.h"
+#include "doc/sprite.h"
 
 #include <algorithm>
 #include <cmath>
 
 namespace doc {
 
+// Enough to keep the plans for the current frame and the onion skin
+// frames around it.
+static constexpr std::size_t kMaxCachedPlans = 16;
+
 RenderPlan::RenderPlan()
 {
 }
@@ -80,4 +85,43 @@ void RenderPlan::processZIndexes() const
             });
 }
 
+RenderPlanRef RenderPlanCache::plan(const Layer* layer,
+                                    const frame_t frame)
+{
+  ASSERT(layer);
+  ASSERT(layer->sprite());
+  const Sprite* sprite = layer->sprite();
+  const ObjectVersion version = sprite->structureVersion();
+
+  for (auto it=m_entries.begin(); it!=m_entries.end(); ++it) {
+    if (it->layer == layer &&
+        it->frame == frame &&
+        it->version == version) {
+      // Move the entry to the front (most recently used)
+      std::rotate(m_entries.begin(), it, it+1);
+      return m_entries.front().plan;
+    }
+  }
+
+  // Plans of previous versions of this same sprite cannot be used
+  // anymore (the cels/layers in them could be deleted), so we don't
+  // even dereference them.
+  m_entries.erase(
+    std::remove_if(m_entries.begin(), m_entries.end(),
+                   [sprite, version](const Entry& entry){
+                     return (entry.sprite == sprite &&
+                             entry.version != version);
+                   }),
+    m_entries.end());
+
+  auto plan = std::make_shared<RenderPlan>();
+  plan->addLayer(layer, frame);
+
+  m_entries.insert(m_entries.begin(), Entry{ sprite, layer, frame, version, plan });
+  if (m_entries.size() > kMaxCachedPlans)
+    m_entries.pop_back();
+
+  return plan;
+}
+
 } // namespace doc
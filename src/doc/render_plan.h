@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2024  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -11,9 +11,14 @@
 #include "doc/cel.h"
 #include "doc/cel_list.h"
 #include "doc/frame.h"
+#include "doc/object_version.h"
+
+#include <memory>
+#include <vector>
 
 namespace doc {
   class Layer;
+  class Sprite;
 
   // Creates a list of cels to be rendered in the correct order
   // (depending on layer ordering + z-index) to render the given root
@@ -51,6 +56,33 @@ namespace doc {
     mutable bool m_processZIndex = true;
   };
 
+  using RenderPlanRef = std::shared_ptr<const RenderPlan>;
+
+  // Keeps the last render plans created to render specific
+  // layers/frames, so we can reuse them on each repaint while the
+  // sprite structure doesn't change (see Sprite::structureVersion()).
+  class RenderPlanCache {
+  public:
+    // Returns the plan to render the given layer (or group of
+    // layers) in the given frame.
+    RenderPlanRef plan(const Layer* layer,
+                       const frame_t frame);
+
+    void clear() { m_entries.clear(); }
+
+  private:
+    struct Entry {
+      const Sprite* sprite;
+      const Layer* layer;
+      frame_t frame;
+      ObjectVersion version;
+      RenderPlanRef plan;
+    };
+
+    // Most recently used entries first
+    std::vector<Entry> m_entries;
+  };
+
 } // namespace doc
 
 #endif
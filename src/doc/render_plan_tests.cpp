@@ -134,6 +134,61 @@ TEST(RenderPlan, ZIndexBugWithEmptyCels)
   d->setZIndex(-3); EXPECT_PLAN(d, a, b);
 }
 
+TEST(RenderPlan, Cache)
+{
+  auto doc = std::make_shared<Document>();
+  ImageSpec spec(ColorMode::INDEXED, 2, 2);
+  Sprite* spr;
+  doc->sprites().add(spr = Sprite::MakeStdSprite(spec));
+
+  LayerImage
+    *lay0 = static_cast<LayerImage*>(spr->root()->firstLayer()),
+    *lay1 = new LayerImage(spr);
+
+  Cel* a = lay0->cel(0), *b;
+  lay1->addCel(b = new Cel(0, ImageRef(Image::create(spec))));
+  spr->root()->insertLayer(lay1, lay0);
+
+  RenderPlanCache cache;
+  RenderPlanRef plan = cache.plan(spr->root(), 0);
+  ASSERT_EQ(2, plan->items().size());
+  EXPECT_EQ(a, plan->items()[0].cel);
+  EXPECT_EQ(b, plan->items()[1].cel);
+
+  // Same structure, same plan
+  EXPECT_EQ(plan, cache.plan(spr->root(), 0));
+  EXPECT_NE(plan, cache.plan(spr->root(), 1));
+  EXPECT_EQ(plan, cache.plan(spr->root(), 0));
+
+  // Z-index
+  a->setZIndex(1);
+  plan = cache.plan(spr->root(), 0);
+  ASSERT_EQ(2, plan->items().size());
+  EXPECT_EQ(b, plan->items()[0].cel);
+  EXPECT_EQ(a, plan->items()[1].cel);
+  a->setZIndex(0);
+
+  // Visibility
+  lay1->setVisible(false);
+  plan = cache.plan(spr->root(), 0);
+  ASSERT_EQ(1, plan->items().size());
+  EXPECT_EQ(a, plan->items()[0].cel);
+  lay1->setVisible(true);
+
+  // Remove cel
+  lay1->removeCel(b);
+  plan = cache.plan(spr->root(), 0);
+  ASSERT_EQ(2, plan->items().size());
+  EXPECT_EQ(nullptr, plan->items()[1].cel);
+  delete b;
+
+  // Remove layer
+  spr->root()->removeLayer(lay1);
+  plan = cache.plan(spr->root(), 0);
+  ASSERT_EQ(1, plan->items().size());
+  delete lay1;
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
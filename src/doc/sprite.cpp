@@ -29,6 +29,7 @@
 #include "doc/tilesets.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <functional>
 #include <memory>
@@ -38,6 +39,7 @@ namespace doc {
 
 static RgbMapAlgorithm g_rgbMapAlgorithm = RgbMapAlgorithm::DEFAULT;
 static gfx::Rect g_defaultGridBounds(0, 0, 16, 16);
+static std::atomic<ObjectVersion> g_structureVersion(0);
 
 // static
 gfx::Rect Sprite::DefaultGridBounds()
@@ -102,6 +104,8 @@ Sprite::Sprite(const ImageSpec& spec,
   }
 
   setPalette(&pal, true);
+
+  incrementStructureVersion();
 }
 
 Sprite::~Sprite()
@@ -334,6 +338,13 @@ bool Sprite::hasVisibleReferenceLayers() const
   return root()->hasVisibleReferenceLayers();
 }
 
+void Sprite::incrementStructureVersion()
+{
+  // We use a global counter so two different sprites (or a sprite
+  // re-created in the same memory address) never share a version.
+  m_structureVersion = ++g_structureVersion;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Palettes
 
@@ -141,6 +141,14 @@ namespace doc {
     layer_t allLayersCount() const;
     bool hasVisibleReferenceLayers() const;
 
+    // Version of the sprite structure (layers hierarchy, layers
+    // visibility, cels, and cels z-index), i.e. everything that
+    // defines a RenderPlan. It's incremented by the doc library
+    // itself each time the structure is modified, and it's unique
+    // between all sprites (so it can be used as a cache key).
+    ObjectVersion structureVersion() const { return m_structureVersion; }
+    void incrementStructureVersion();
+
     ////////////////////////////////////////
     // Palettes
 
@@ -253,6 +261,7 @@ namespace doc {
     PalettesList m_palettes;               // list of palettes
     LayerGroup* m_root;                    // main group of layers
     gfx::Rect m_gridBounds;                // grid settings
+    ObjectVersion m_structureVersion = 0;  // see structureVersion()
 
     // Current rgb map
     mutable RgbMapAlgorithm m_rgbMapAlgorithm;
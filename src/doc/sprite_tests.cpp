@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2022 Igara Studio S.A.
+// Copyright (c) 2018-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -193,6 +193,60 @@ TEST(Sprite, CelsRange)
   EXPECT_EQ(3, i);
 }
 
+TEST(Sprite, LinkedCels)
+{
+  std::shared_ptr<Sprite> sprPtr(std::make_shared<Sprite>(
+                                   ImageSpec(ColorMode::RGB, 32, 32), 256));
+  Sprite* spr = sprPtr.get();
+  spr->setTotalFrames(6);
+
+  LayerImage* lay1 = new LayerImage(spr);
+  spr->root()->addLayer(lay1);
+
+  ImageRef imgA(Image::create(IMAGE_RGB, 32, 32));
+  Cel* celA = new Cel(frame_t(1), imgA);
+  Cel* celB = Cel::MakeLink(frame_t(3), celA);
+  Cel* celC = Cel::MakeLink(frame_t(5), celA);
+  Cel* celD = Cel::MakeCopy(frame_t(2), celA);
+  // Add cels in a different order than frames
+  lay1->addCel(celC);
+  lay1->addCel(celA);
+  lay1->addCel(celD);
+  lay1->addCel(celB);
+
+  EXPECT_EQ(nullptr, celA->link());
+  EXPECT_EQ(celA, celB->link());
+  EXPECT_EQ(celA, celC->link());
+  EXPECT_EQ(nullptr, celD->link());
+  EXPECT_EQ(2, celA->links());
+  EXPECT_EQ(2, celB->links());
+  EXPECT_EQ(0, celD->links());
+
+  // Moving the original cel after its links
+  lay1->moveCel(celA, frame_t(4));
+  EXPECT_EQ(nullptr, celB->link());
+  EXPECT_EQ(celB, celA->link());
+  EXPECT_EQ(celB, celC->link());
+
+  // Unlink a cel
+  celC->setDataRef(std::make_shared<CelData>(*celC->data()));
+  EXPECT_EQ(nullptr, celC->link());
+  EXPECT_EQ(0, celC->links());
+  EXPECT_EQ(1, celB->links());
+
+  // Link it again
+  celC->setDataRef(celB->dataRef());
+  EXPECT_EQ(celB, celC->link());
+  EXPECT_EQ(2, celA->links());
+
+  // Remove the first cel
+  lay1->removeCel(celB);
+  EXPECT_EQ(nullptr, celA->link());
+  EXPECT_EQ(celA, celC->link());
+  EXPECT_EQ(1, celA->links());
+  delete celB;
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2024  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -14,6 +14,40 @@
 
 namespace doc {
 
+// static
+const UserData::PropertiesMaps& UserData::emptyPropertiesMaps()
+{
+  static const PropertiesMaps empty;
+  return empty;
+}
+
+const UserData::Properties& UserData::properties(const std::string& groupKey) const
+{
+  static const Properties empty;
+  const PropertiesMaps& maps = propertiesMaps();
+  auto it = maps.find(groupKey);
+  return (it != maps.end() ? it->second: empty);
+}
+
+UserData::Variant UserData::getPropertyValue(const std::string& groupKey,
+                                             const std::string& field) const
+{
+  const Properties& props = properties(groupKey);
+  auto it = props.find(field);
+  return (it != props.end() ? it->second: Variant());
+}
+
+UserData::PropertiesMaps& UserData::propertiesMaps()
+{
+  if (!m_propertiesMaps)
+    m_propertiesMaps = std::make_shared<PropertiesMaps>();
+  // Copy-on-write: this UserData is going to be modified and the
+  // properties are shared with other objects.
+  else if (m_propertiesMaps.use_count() > 1)
+    m_propertiesMaps = std::make_shared<PropertiesMaps>(*m_propertiesMaps);
+  return *m_propertiesMaps;
+}
+
 size_t count_nonempty_properties_maps(const UserData::PropertiesMaps& propertiesMaps)
 {
   size_t i = 0;
@@ -23,6 +57,46 @@ size_t count_nonempty_properties_maps(const UserData::PropertiesMaps& properties
   return i;
 }
 
+PropertiesDiff diff_properties(const UserData::Properties& oldProperties,
+                               const UserData::Properties& newProperties)
+{
+  PropertiesDiff diff;
+
+  // Both maps are sorted by key, so we can walk them in parallel
+  auto a = oldProperties.begin(), aEnd = oldProperties.end();
+  auto b = newProperties.begin(), bEnd = newProperties.end();
+  while (a != aEnd || b != bEnd) {
+    if (b == bEnd || (a != aEnd && a->first < b->first)) {
+      diff.push_back({ a->first, a->second, nullptr });
+      ++a;
+    }
+    else if (a == aEnd || b->first < a->first) {
+      diff.push_back({ b->first, nullptr, b->second });
+      ++b;
+    }
+    else {
+      if (!(a->second == b->second))
+        diff.push_back({ a->first, a->second, b->second });
+      ++a;
+      ++b;
+    }
+  }
+  return diff;
+}
+
+void apply_properties_diff(UserData::Properties& properties,
+                           const PropertiesDiff& diff,
+                           const bool undo)
+{
+  for (const PropertyChange& change : diff) {
+    const UserData::Variant& value = (undo ? change.oldValue: change.newValue);
+    if (value.type() == USER_DATA_PROPERTY_TYPE_NULLPTR)
+      properties.erase(change.key);
+    else
+      properties[change.key] = value;
+  }
+}
+
 static bool is_negative(const UserData::Variant& value)
 {
   switch (value.type()) {
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2022-2023 Igara Studio S.A.
+// Copyright (c) 2022-2024 Igara Studio S.A.
 // Copyright (c) 2001-2015 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -19,6 +19,7 @@
 #include <cstddef>
 #include <limits>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <variant>
@@ -98,20 +99,44 @@ namespace doc {
       }
     };
 
+    // Properties maps are shared between copies of the same UserData
+    // (copy-on-write), so copying user data (e.g. for undo or when a
+    // tileset is copied) doesn't duplicate all properties.
+    using PropertiesMapsRef = std::shared_ptr<PropertiesMaps>;
+
     UserData() : m_color(0) {
     }
 
     size_t size() const { return m_text.size(); }
     bool isEmpty() const {
-      return m_text.empty() && !doc::rgba_geta(m_color) && m_propertiesMaps.empty();
+      return m_text.empty() && !doc::rgba_geta(m_color) && propertiesMaps().empty();
     }
 
     const std::string& text() const { return m_text; }
     color_t color() const { return m_color; }
-    const PropertiesMaps& propertiesMaps() const { return m_propertiesMaps; }
-    PropertiesMaps& propertiesMaps() { return m_propertiesMaps; }
+
+    // Read-only access, never copies the properties.
+    const PropertiesMaps& propertiesMaps() const {
+      return (m_propertiesMaps ? *m_propertiesMaps: emptyPropertiesMaps());
+    }
+    const Properties& properties() const { return properties(std::string()); }
+    const Properties& properties(const std::string& groupKey) const;
+
+    // Returns a copy of the value of the given property (or a null
+    // variant if it doesn't exist) without copying the properties.
+    Variant getPropertyValue(const std::string& groupKey,
+                             const std::string& field) const;
+
+    // Read/write access, the properties are copied if they are shared
+    // with other UserData.
+    PropertiesMaps& propertiesMaps();
     Properties& properties() { return properties(std::string()); }
-    Properties& properties(const std::string& groupKey) { return m_propertiesMaps[groupKey]; }
+    Properties& properties(const std::string& groupKey) { return propertiesMaps()[groupKey]; }
+
+    // Shares the given properties maps with this user data (used to
+    // share identical sets of properties between several objects).
+    const PropertiesMapsRef& propertiesMapsRef() const { return m_propertiesMaps; }
+    void setPropertiesMapsRef(const PropertiesMapsRef& ref) { m_propertiesMaps = ref; }
 
     void setText(const std::string& text) { m_text = text; }
     void setColor(color_t color) { m_color = color; }
@@ -126,9 +151,11 @@ namespace doc {
     }
 
   private:
+    static const PropertiesMaps& emptyPropertiesMaps();
+
     std::string m_text;
     color_t m_color;
-    PropertiesMaps m_propertiesMaps;
+    PropertiesMapsRef m_propertiesMaps;
   };
 
   // macOS 10.9 C++ runtime doesn't support std::get<T>(value)
@@ -165,6 +192,25 @@ namespace doc {
 
   size_t count_nonempty_properties_maps(const UserData::PropertiesMaps& propertiesMaps);
 
+  // Compact representation of the changes between two sets of
+  // properties (only the modified keys), used to store undo
+  // information. A nullptr value means that the key doesn't exist.
+  struct PropertyChange {
+    std::string key;
+    UserData::Variant oldValue;
+    UserData::Variant newValue;
+  };
+  using PropertiesDiff = std::vector<PropertyChange>;
+
+  PropertiesDiff diff_properties(const UserData::Properties& oldProperties,
+                                 const UserData::Properties& newProperties);
+
+  // Applies the "newValue" of each change (or the "oldValue" if
+  // "undo" is true).
+  void apply_properties_diff(UserData::Properties& properties,
+                             const PropertiesDiff& diff,
+                             const bool undo);
+
   // If all the elements of vector have the same type, returns that type, also
   // if this type is an integer, it tries to reduce it to the minimum int type
   // capable of storing all the vector values.
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2022 Igara Studio S.A.
+// Copyright (c) 2022-2024 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -12,6 +12,8 @@
 
 #include "doc/user_data.h"
 
+#include <utility>
+
 using namespace doc;
 using Variant = UserData::Variant;
 using Fixed = UserData::Fixed;
@@ -180,6 +182,71 @@ TEST(ExtensionProperties, SimpleProperties)
   EXPECT_TRUE(data.properties("someExtensionId").size() == 0);
 }
 
+TEST(CustomProperties, CopyOnWrite)
+{
+  UserData a;
+  a.properties()["number"] = int32_t(1);
+  a.properties("ext")["text"] = std::string("abc");
+
+  // Copies share the same properties
+  UserData b = a;
+  EXPECT_EQ(a.propertiesMapsRef(), b.propertiesMapsRef());
+  EXPECT_EQ(&std::as_const(a).propertiesMaps(), &std::as_const(b).propertiesMaps());
+
+  // Read-only access doesn't copy the properties
+  const UserData& constB = b;
+  EXPECT_EQ(1, get_value<int32_t>(constB.properties().at("number")));
+  EXPECT_TRUE(constB.properties("missing").empty());
+  EXPECT_EQ(1, get_value<int32_t>(b.getPropertyValue("", "number")));
+  EXPECT_EQ("abc", get_value<std::string>(b.getPropertyValue("ext", "text")));
+  EXPECT_EQ(USER_DATA_PROPERTY_TYPE_NULLPTR, b.getPropertyValue("", "missing").type());
+  EXPECT_EQ(USER_DATA_PROPERTY_TYPE_NULLPTR, b.getPropertyValue("missing", "text").type());
+  EXPECT_EQ(a.propertiesMapsRef(), b.propertiesMapsRef());
+
+  // Modifying one of them copies the properties
+  b.properties()["number"] = int32_t(2);
+  EXPECT_NE(a.propertiesMapsRef(), b.propertiesMapsRef());
+  EXPECT_EQ(1, get_value<int32_t>(a.properties()["number"]));
+  EXPECT_EQ(2, get_value<int32_t>(b.properties()["number"]));
+  EXPECT_EQ("abc", get_value<std::string>(b.properties("ext")["text"]));
+
+  // Empty user data doesn't allocate properties
+  UserData c;
+  EXPECT_TRUE(c.isEmpty());
+  EXPECT_EQ(nullptr, c.propertiesMapsRef());
+}
+
+TEST(CustomProperties, Diff)
+{
+  Properties oldProps = {
+    { "a", int32_t(1) },
+    { "b", std::string("same") },
+    { "c", Vector{ 1, 2, 3 } },
+  };
+  Properties newProps = {
+    { "b", std::string("same") },
+    { "c", Vector{ 1, 2, 4 } },
+    { "d", true },
+  };
+
+  PropertiesDiff diff = diff_properties(oldProps, newProps);
+  ASSERT_EQ(3, diff.size());
+  EXPECT_EQ("a", diff[0].key);
+  EXPECT_EQ(USER_DATA_PROPERTY_TYPE_NULLPTR, diff[0].newValue.type());
+  EXPECT_EQ("c", diff[1].key);
+  EXPECT_EQ("d", diff[2].key);
+  EXPECT_EQ(USER_DATA_PROPERTY_TYPE_NULLPTR, diff[2].oldValue.type());
+
+  Properties props = oldProps;
+  apply_properties_diff(props, diff, false);
+  EXPECT_TRUE(props == newProps);
+
+  apply_properties_diff(props, diff, true);
+  EXPECT_TRUE(props == oldProps);
+
+  EXPECT_TRUE(diff_properties(oldProps, oldProps).empty());
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019 Igara Studio S.A.
+// Copyright (c) 2019-2024 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,25 +9,184 @@
 #include "config.h"
 #endif
 
+#include "render/get_sprite_pixel.h"
+
+#include "doc/blend_internals.h"
 #include "doc/doc.h"
+#include "doc/primitives_fast.h"
+#include "doc/render_plan.h"
 #include "gfx/clip.h"
 #include "render/render.h"
 
+#include <cmath>
+#include <vector>
+
 namespace render {
 
 using namespace doc;
 
+namespace {
+
+struct PointSource {
+  color_t pixel;
+  int opacity;
+  BlendMode blendMode;
+};
+
+// Collects the pixels of the plan cels in the given point from top to
+// bottom, stopping in the first pixel that hides all the pixels below
+// it. Returns false if a cel needs the full Render (tilemaps,
+// reference layers with scaled images, etc.).
+template<typename ImageTraits>
+bool collect_point_sources(const Sprite* sprite,
+                           const RenderPlan& plan,
+                           const gfx::Point& pt,
+                           const frame_t frame,
+                           std::vector<PointSource>& sources,
+                           bool& opaque)
+{
+  const int palSize = sprite->palette(frame)->size();
+  const RenderPlan::Items& items = plan.items();
+
+  opaque = false;
+
+  // The Background layer is rendered before the transparent layers
+  // (see Render::renderSpriteLayers()), so we visit transparent
+  // layers first (from top to bottom) and then the Background.
+  for (int pass=0; pass<2 && !opaque; ++pass) {
+    const bool background = (pass == 1);
+
+    for (auto it=items.rbegin(), end=items.rend(); it!=end; ++it) {
+      const Layer* layer = it->layer;
+      if (layer->isBackground() != background)
+        continue;
+
+      if (layer->isTilemap() ||
+          layer->isReference())
+        return false;
+
+      const Cel* cel = (it->cel ? it->cel: layer->cel(frame));
+      if (!cel)
+        continue;
+
+      const Image* image = cel->image();
+      if (!image || image->pixelFormat() != ImageTraits::pixel_format)
+        return false;
+
+      const gfx::Point p = pt - cel->position();
+      if (!image->bounds().contains(p))
+        continue;
+
+      const color_t pixel = get_pixel_fast<ImageTraits>(image, p.x, p.y);
+      if (pixel == image->maskColor())
+        continue;
+
+      const auto imgLayer = static_cast<const LayerImage*>(layer);
+      const BlendMode blendMode = imgLayer->blendMode();
+      int t;
+      const int opacity = MUL_UN8(cel->opacity(), imgLayer->opacity(), t);
+
+      // Indexed images ignore opacity and blend modes, any valid
+      // index replaces the destination pixel
+      if (ImageTraits::pixel_format == IMAGE_INDEXED) {
+        if (int(pixel) >= palSize)
+          continue;
+        opaque = true;
+      }
+      else if (blendMode == BlendMode::NORMAL &&
+               opacity == 255) {
+        opaque = (ImageTraits::pixel_format == IMAGE_RGB ?
+                  rgba_geta(pixel) == 255:
+                  graya_geta(pixel) == 255);
+      }
+
+      sources.push_back(PointSource{ pixel, opacity, blendMode });
+      if (opaque)
+        break;
+    }
+  }
+  return true;
+}
+
+template<typename ImageTraits>
+bool get_plan_pixel_templ(const Sprite* sprite,
+                          const RenderPlan& plan,
+                          const gfx::Point& pt,
+                          const frame_t frame,
+                          const bool newBlend,
+                          color_t& color)
+{
+  std::vector<PointSource> sources;
+  bool opaque;
+  if (!collect_point_sources<ImageTraits>(sprite, plan, pt, frame,
+                                          sources, opaque))
+    return false;
+
+  // An opaque pixel with normal blend mode gives the same pixel (no
+  // matter the backdrop), so we can start from it.
+  auto it = sources.rbegin(), end = sources.rend();
+  if (opaque) {
+    color = it->pixel;
+    ++it;
+  }
+  else {
+    color = (ImageTraits::pixel_format == IMAGE_INDEXED ?
+             sprite->transparentColor(): 0);
+  }
+
+  for (; it!=end; ++it) {
+    if (ImageTraits::pixel_format == IMAGE_INDEXED)
+      color = it->pixel;
+    else
+      color = ImageTraits::get_blender(it->blendMode, newBlend)(
+        color, it->pixel, it->opacity);
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+bool get_plan_pixel(const Sprite* sprite,
+                    const RenderPlan& plan,
+                    const gfx::Point& pt,
+                    const frame_t frame,
+                    const bool newBlend,
+                    color_t& color)
+{
+  switch (sprite->pixelFormat()) {
+    case IMAGE_RGB:
+      return get_plan_pixel_templ<RgbTraits>(sprite, plan, pt, frame, newBlend, color);
+    case IMAGE_GRAYSCALE:
+      return get_plan_pixel_templ<GrayscaleTraits>(sprite, plan, pt, frame, newBlend, color);
+    case IMAGE_INDEXED:
+      return get_plan_pixel_templ<IndexedTraits>(sprite, plan, pt, frame, newBlend, color);
+  }
+  return false;
+}
+
 color_t get_sprite_pixel(const Sprite* sprite,
                          const double x,
                          const double y,
                          const frame_t frame,
                          const Projection& proj,
-                         const bool newBlend)
+                         const bool newBlend,
+                         const RenderPlan* plan)
 {
   color_t color = 0;
 
   if ((x >= 0.0) && (x < sprite->width()) &&
       (y >= 0.0) && (y < sprite->height())) {
+    const gfx::Point pt(int(std::floor(x)),
+                        int(std::floor(y)));
+
+    RenderPlan localPlan;
+    if (!plan) {
+      localPlan.addLayer(sprite->root(), frame);
+      plan = &localPlan;
+    }
+    if (get_plan_pixel(sprite, *plan, pt, frame, newBlend, color))
+      return color;
+
     std::unique_ptr<Image> image(Image::create(sprite->pixelFormat(), 1, 1));
 
     render::Render render;
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019 Igara Studio S.A.
+// Copyright (c) 2019-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,9 +9,12 @@
 #define RENDER_GET_SPRITE_PIXEL_H_INCLUDED
 #pragma once
 
+#include "doc/color.h"
 #include "doc/frame.h"
+#include "gfx/point.h"
 
 namespace doc {
+  class RenderPlan;
   class Sprite;
 }
 
@@ -22,13 +25,28 @@ namespace render {
 
   // Gets a pixel from the sprite in the specified position. If in the
   // specified coordinates there're background this routine will
-  // return the 0 color (the mask-color).
+  // return the 0 color (the mask-color). The plan (of the sprite root
+  // layer in the given frame) can be given to avoid creating it on
+  // each call (e.g. picking colors continuously).
   color_t get_sprite_pixel(const Sprite* sprite,
                            const double x,
                            const double y,
                            const frame_t frame,
                            const Projection& proj,
-                           const bool newBlend);
+                           const bool newBlend,
+                           const RenderPlan* plan = nullptr);
+
+  // Composes the pixel in the given sprite point from the cels of the
+  // render plan (from top to bottom, until an opaque pixel is found)
+  // without rendering the sprite. Returns false if the plan contains
+  // cels that need the whole Render (e.g. tilemaps or reference
+  // layers).
+  bool get_plan_pixel(const Sprite* sprite,
+                      const RenderPlan& plan,
+                      const gfx::Point& pt,
+                      const frame_t frame,
+                      const bool newBlend,
+                      color_t& color);
 
 } // namespace render
 
@@ -782,10 +782,9 @@ void Render::renderLayer(
 
   m_globalOpacity = 255;
 
-  doc::RenderPlan plan;
-  plan.addLayer(layer, frame);
+  const doc::RenderPlanRef plan = m_plans.plan(layer, frame);
   renderPlan(
-    plan, dstImage, area,
+    *plan, dstImage, area,
     frame, compositeImage,
     true, true, blendMode);
 }
@@ -881,12 +880,11 @@ void Render::renderSpriteLayers(Image* dstImage,
                                 frame_t frame,
                                 CompositeImageFunc compositeImage)
 {
-  doc::RenderPlan plan;
-  plan.addLayer(m_sprite->root(), frame);
+  const doc::RenderPlanRef plan = m_plans.plan(m_sprite->root(), frame);
 
   // Draw the background layer.
   m_globalOpacity = 255;
-  renderPlan(plan, dstImage,
+  renderPlan(*plan, dstImage,
              area, frame, compositeImage,
              true,
              false,
@@ -898,7 +896,7 @@ void Render::renderSpriteLayers(Image* dstImage,
 
   // Draw the transparent layers.
   m_globalOpacity = 255;
-  renderPlan(plan, dstImage,
+  renderPlan(*plan, dstImage,
              area, frame, compositeImage,
              false,
              true,
@@ -997,10 +995,9 @@ void Render::renderOnionskin(
         else if (m_onionskin.type() == OnionskinType::RED_BLUE_TINT)
           blendMode = (frameOut < frame ? BlendMode::RED_TINT: BlendMode::BLUE_TINT);
 
-        doc::RenderPlan plan;
-        plan.addLayer(onionLayer, frameIn);
+        const doc::RenderPlanRef plan = m_plans.plan(onionLayer, frameIn);
         renderPlan(
-          plan, dstImage,
+          *plan, dstImage,
           area, frameIn, compositeImage,
           // Render background only for "in-front" onion skinning and
           // when opacity is < 255
@@ -1099,7 +1096,7 @@ void Render::renderImage(
 }
 
 void Render::renderPlan(
-  RenderPlan& plan,
+  const RenderPlan& plan,
   Image* image,
   const gfx::Clip& area,
   const frame_t frame,
@@ -1194,6 +1191,16 @@ void Render::renderPlan(
               celBounds = cel->bounds();
           }
 
+          // Skip cels outside the area to be rendered (e.g. when we
+          // repaint a small region of a sprite with a lot of layers)
+          if (celImage &&
+              !drawExtra &&
+              celImage->pixelFormat() != IMAGE_TILEMAP &&
+              gfx::RectF(area.srcBounds())
+                .createIntersection(m_proj.apply(celBounds)).isEmpty()) {
+            break;
+          }
+
           if (celImage) {
             const LayerImage* imgLayer = static_cast<const LayerImage*>(layer);
             BlendMode layerBlendMode =
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2024 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -15,6 +15,7 @@
 #include "doc/doc.h"
 #include "doc/frame.h"
 #include "doc/pixel_format.h"
+#include "doc/render_plan.h"
 #include "doc/tile.h"
 #include "gfx/clip.h"
 #include "gfx/point.h"
@@ -29,7 +30,6 @@ namespace doc {
   class Image;
   class Layer;
   class Palette;
-  class RenderPlan;
   class Sprite;
   class Tileset;
 }
@@ -162,7 +162,7 @@ namespace render {
       const CompositeImageFunc compositeImage);
 
     void renderPlan(
-      doc::RenderPlan& plan,
+      const doc::RenderPlan& plan,
       Image* image,
       const gfx::Clip& area,
       const frame_t frame,
@@ -224,6 +224,9 @@ namespace render {
     BlendMode m_previewBlendMode;
     OnionskinOptions m_onionskin;
     ImageBufferPtr m_tmpBuf;
+
+    // Plans reused between consecutive renders of the same sprite
+    doc::RenderPlanCache m_plans;
   };
 
   void composite_image(Image* dst,
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2024 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,6 +11,7 @@
 
 #include <gtest/gtest.h>
 
+#include "render/get_sprite_pixel.h"
 #include "render/render.h"
 
 #include "doc/cel.h"
@@ -19,7 +20,9 @@
 #include "doc/layer.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
+#include "doc/render_plan.h"
 
+#include <cstdlib>
 #include <memory>
 
 using namespace doc;
@@ -277,6 +280,83 @@ TEST(Render, BugWithMultiplesOf3ZoomFactors)
   }
 }
 
+TYPED_TEST(RenderAllModes, PlanPixelIsSameAsRender)
+{
+  typedef TypeParam ImageTraits;
+  const int w = 8, h = 8;
+  const BlendMode blendModes[] = { BlendMode::NORMAL,
+                                   BlendMode::MULTIPLY,
+                                   BlendMode::SCREEN,
+                                   BlendMode::DIFFERENCE };
+  std::srand(1);
+
+  for (int background=0; background<2; ++background) {
+    std::shared_ptr<Document> doc = std::make_shared<Document>();
+    Sprite* sprite = Sprite::MakeStdSprite(ImageSpec(ImageTraits::color_mode, w, h));
+    doc->sprites().add(sprite);
+
+    LayerImage* bottom = static_cast<LayerImage*>(sprite->root()->firstLayer());
+    if (background)
+      bottom->configureAsBackground();
+
+    for (int i=0; i<4; ++i) {
+      LayerImage* layer = bottom;
+      if (i > 0) {
+        layer = new LayerImage(sprite);
+        sprite->root()->addLayer(layer);
+        layer->setBlendMode(blendModes[std::rand() % 4]);
+        layer->setOpacity((std::rand() & 1) ? 255: std::rand() & 255);
+
+        ImageRef image(Image::create(ImageTraits::pixel_format, w-i, h-i));
+        Cel* cel = new Cel(frame_t(0), image);
+        cel->setPosition(i, i/2);
+        cel->setOpacity((std::rand() & 1) ? 255: std::rand() & 255);
+        layer->addCel(cel);
+      }
+
+      Image* image = layer->cel(0)->image();
+      for (int y=0; y<image->height(); ++y) {
+        for (int x=0; x<image->width(); ++x) {
+          color_t c = std::rand() & 0xff;
+          switch (ImageTraits::pixel_format) {
+            case IMAGE_RGB:
+              c = rgba(c, std::rand() & 0xff, c/2, (std::rand() & 1) ? 255: c);
+              break;
+            case IMAGE_GRAYSCALE:
+              c = graya(c, (std::rand() & 1) ? 255: std::rand() & 0xff);
+              break;
+            case IMAGE_INDEXED:
+              c &= 7;
+              break;
+          }
+          put_pixel(image, x, y, c);
+        }
+      }
+    }
+
+    RenderPlan plan;
+    plan.addLayer(sprite->root(), frame_t(0));
+
+    for (const bool newBlend : { false, true }) {
+      std::unique_ptr<Image> dst(Image::create(ImageTraits::pixel_format, w, h));
+      Render render;
+      render.setNewBlend(newBlend);
+      render.renderSprite(dst.get(), sprite, frame_t(0));
+
+      for (int y=0; y<h; ++y) {
+        for (int x=0; x<w; ++x) {
+          color_t c;
+          ASSERT_TRUE(get_plan_pixel(sprite, plan, gfx::Point(x, y),
+                                     frame_t(0), newBlend, c));
+          EXPECT_EQ(get_pixel(dst.get(), x, y), c)
+            << "x=" << x << " y=" << y << " newBlend=" << newBlend
+            << " background=" << background;
+        }
+      }
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,4 +1,4 @@
--- Copyright (C) 2023  Igara Studio S.A.
+-- Copyright (C) 2023-2024  Igara Studio S.A.
 -- Copyright (C) 2018  David Capello
 --
 -- This file is released under the terms of the MIT license.
@@ -36,3 +36,54 @@ assert(c.opacity == 128)
 assert(c.zIndex == 0)
 c.zIndex = -2
 assert(c.zIndex == -2)
+
+-- Set an image with the same size/format (only modified pixels are copied)
+do
+  local s = Sprite(4, 4)
+  local c = s.cels[1]
+  local img = Image(c.image)
+  img:drawPixel(1, 2, app.pixelColor.rgba(255, 0, 0))
+  c.image = img
+  assert(c.image:isEqual(img))
+  assert(c.image:getPixel(1, 2) == app.pixelColor.rgba(255, 0, 0))
+
+  app.undo()
+  assert(c.image:getPixel(1, 2) == 0)
+  app.redo()
+  assert(c.image:isEqual(img))
+
+  -- Set an image with a different size
+  local img2 = Image(2, 3)
+  img2:clear(app.pixelColor.rgba(0, 255, 0))
+  c.image = img2
+  assert(c.image.width == 2)
+  assert(c.image.height == 3)
+  assert(c.image:isEqual(img2))
+  app.undo()
+  assert(c.image:isEqual(img))
+end
+
+-- Set the image of a tilemap cel (the whole image is replaced)
+do
+  local s = Sprite(32, 32, ColorMode.INDEXED)
+  s.gridBounds = Rectangle{ 0, 0, 4, 4 }
+  app.command.NewLayer{ tilemap=true }
+  local tilemapLay = s.layers[2]
+  app.useTool{
+    tool='pencil',
+    color=1,
+    layer=tilemapLay,
+    tilesetMode=TilesetMode.STACK,
+    points={ Point(1, 2) }}
+  local c = tilemapLay:cel(1)
+  assert(c.image.colorMode == ColorMode.TILEMAP)
+  assert(c.image:getPixel(0, 0) == 1)
+
+  local img = Image(c.image)
+  img:drawPixel(0, 0, 0)
+  c.image = img
+  assert(c.image.colorMode == ColorMode.TILEMAP)
+  assert(c.image:getPixel(0, 0) == 0)
+  app.undo()
+  assert(c.image:getPixel(0, 0) == 1)
+end